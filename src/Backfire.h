@@ -1,5 +1,10 @@
 #pragma once
 #include <Arduino.h>
+#include "cut_output.h"
+
+// Quyết định khi nào bắn (SHIFT / OVERRUN) chạy trong tick() của loop; chuỗi nhịp on/off được
+// biên dịch thành CUT::Timeline và do timer của scheduler cắt phát → nhịp không trôi theo loop.
+// Mốc thời gian: µs trên timeline của CUT (CUT::nowUs()).
 
 class BackfireController {
 public:
@@ -8,6 +13,9 @@ public:
     BF_OVERRUN = 0x02    // bắn khi dRPM/dt âm lớn (đóng ga nhanh)
   };
 
+  // warmup tính bằng µs trên timeline 32-bit (tràn sau ~4295 s): giới hạn ở 10 phút
+  static constexpr uint16_t WARMUP_S_MAX = 600;
+
   // Config lồng trong class -> tránh đụng tên với code cũ của bạn
   struct Config {
     bool     enabled                = true;      // bật/tắt backfire
@@ -16,7 +24,7 @@ public:
 
     uint16_t rpm_min                = 4000;      // chỉ kích trong khoảng
     uint16_t rpm_max                = 9000;
-    uint16_t warmup_s               = 120;       // trễ khởi động (s)
+    uint16_t warmup_s               = 120;       // trễ khởi động (s), tối đa WARMUP_S_MAX
 
     uint16_t decel_thresh_rpm_s     = 3000;      // dRPM/dt <= -ngưỡng thì kích OVERRUN
     uint16_t window_after_shift_ms  = 250;       // cửa sổ sau khi QS nhả
@@ -30,97 +38,125 @@ public:
   // Callbacks bạn gắn vào:
   using GetRpmFn        = uint16_t (*)();          // trả RPM tức thời
   using IsCutBusyFn     = bool     (*)();          // đang có cut nào đang chạy?
-  using RequestIgnCutFn = void     (*)(uint16_t);  // yêu cầu cắt IGN ms
+  using PlayTimelineFn  = bool     (*)(uint32_t t0_us, const CUT::Timeline&); // phát chuỗi cắt IGN
   using IsIgnModeFn     = bool     (*)();          // output hiện tại là IGN?
+  using GetAccelFn      = int32_t  (*)();          // dRPM/dt (rpm/s) từ bộ ước lượng, tuỳ chọn
 
   void begin(const Config& cfg,
              GetRpmFn getRpm,
              IsCutBusyFn isBusy,
-             RequestIgnCutFn requestIgnCut,
-             IsIgnModeFn isIgnMode)
+             PlayTimelineFn playTimeline,
+             IsIgnModeFn isIgnMode,
+             GetAccelFn getAccel = nullptr)
   {
     _cfg = cfg;
     _getRpm        = getRpm;
     _isBusy        = isBusy;
-    _requestIgnCut = requestIgnCut;
+    _play          = playTimeline;
     _isIgnMode     = isIgnMode;
+    _getAccel      = getAccel;
 
     _lastRpm = 0;
-    _lastTs  = millis();
-    _startedAt = _lastTs;
+    _lastTs  = 0;
+    _startedAt = 0;
+    _warm = false;
+    _started = false;
 
     _active = false;
-    _burstsLeft = 0;
-    _nextPulseAt = _patternEnd = _lastFireAt = _shiftWindowUntil = 0;
+    _fired = false;
+    _patternEnd = _lastFireAt = 0;
+    _shiftPending = false;
+    _shiftAt = _shiftWindowUntil = 0;
     _drpm_per_s = 0;
   }
 
   // có thể đổi config khi đang chạy
   void setConfig(const Config& cfg) { _cfg = cfg; }
 
-  // gọi một lần sau begin để đánh dấu thời điểm bắt đầu chạy
-  void markStarted(uint32_t now_ms) { _startedAt = now_ms; }
+  // gọi khi quickshift bắt đầu cắt, end_us = lúc cut QS sẽ nhả (có thể ở tương lai):
+  // chuỗi SHIFT được hẹn bắt đầu đúng lúc nhả, cửa sổ tính từ đó
+  void onShiftCut(uint32_t end_us) {
+    _shiftPending = true;
+    _shiftAt = end_us;
+    _shiftWindowUntil = end_us + (uint32_t)_cfg.window_after_shift_ms * 1000UL;
+  }
 
-  // gọi NGAY khi quickshift vừa NHẢ cắt
-  void onShiftCutCompleted(uint32_t now_ms) {
-    _shiftWindowUntil = now_ms + _cfg.window_after_shift_ms;
+  // Nhịp i: cắt [i·(on+off), i·(on+off) + on) µs kể từ t0; off_gap_us = khoảng OFF (đã clamp)
+  // rơ-le cần sau mỗi nhịp, kể cả nhịp cuối
+  static CUT::Timeline compile(const Config& c, uint32_t &off_gap_us) {
+    // clamp an toàn cho rơ-le cơ
+    uint16_t on_ms  = c.burst_on_ms;  if (on_ms  < 20) on_ms  = 20;
+    uint16_t off_ms = c.burst_off_ms; if (off_ms < 40) off_ms = 40;
+    uint8_t n = c.burst_count ? c.burst_count : 1;
+    if (n > CUT::TIMELINE_MAX) n = CUT::TIMELINE_MAX;
+
+    CUT::Timeline tl{};
+    tl.n = n;
+    for (uint8_t i = 0; i < n; i++) {
+      tl.on_us[i]  = (uint32_t)i * (on_ms + off_ms) * 1000UL;
+      tl.off_us[i] = tl.on_us[i] + (uint32_t)on_ms * 1000UL;
+    }
+    off_gap_us = (uint32_t)off_ms * 1000UL;
+    return tl;
   }
 
-  // tick ~ mỗi 1–5ms
-  void tick(uint32_t now_ms) {
+  // gọi mỗi vòng loop; chỉ quyết định, không cần chu kỳ đều
+  void tick(uint32_t now_us) {
+    if (!_started) { _started = true; _startedAt = now_us; _lastTs = now_us; }
     if (!_cfg.enabled) return;
-    if (!_getRpm || !_isBusy || !_requestIgnCut || !_isIgnMode) return;
+    if (!_getRpm || !_isBusy || !_play || !_isIgnMode) return;
     if (_cfg.ign_only && !_isIgnMode()) return;
-    if ((now_ms - _startedAt) < (uint32_t)_cfg.warmup_s * 1000UL) return;
+    if (!_warm) {
+      const uint16_t w = _cfg.warmup_s < WARMUP_S_MAX ? _cfg.warmup_s : WARMUP_S_MAX;
+      if ((now_us - _startedAt) < (uint32_t)w * 1000000UL) return;
+      _warm = true;
+    }
 
-    // cập nhật dRPM/dt (đủ 20ms mới cập nhật để bớt nhiễu)
+    // dRPM/dt: ưu tiên bộ ước lượng theo từng cạnh (RPM::accel),
+    // không có thì sai phân 2 mẫu cách nhau >= 20ms như cũ
     const uint16_t rpm = _getRpm();
-    const uint32_t dt  = now_ms - _lastTs;
-    if (dt >= 20) {
+    const uint32_t dt  = now_us - _lastTs;
+    if (_getAccel) {
+      _drpm_per_s = _getAccel();
+    } else if (dt >= 20000) {
       const int32_t drpm = (int32_t)rpm - (int32_t)_lastRpm;
-      _drpm_per_s = (int32_t)((int64_t)drpm * 1000 / (int32_t)dt);
+      _drpm_per_s = (int32_t)((int64_t)drpm * 1000000 / (int32_t)dt);
       _lastRpm = rpm;
-      _lastTs  = now_ms;
+      _lastTs  = now_us;
     }
 
     // kết thúc chuỗi hiện tại?
-    if (_active && now_ms >= _patternEnd) {
+    if (_active && (int32_t)(now_us - _patternEnd) >= 0) {
       _active = false;
     }
+    // cửa sổ SHIFT hết hạn
+    if (_shiftPending && (int32_t)(now_us - _shiftWindowUntil) > 0) _shiftPending = false;
 
     // rảnh → xét trigger mới
-    if (!_active && !_isBusy() && (now_ms - _lastFireAt) >= _cfg.refractory_ms) {
-      const bool rpm_ok     = (rpm >= _cfg.rpm_min && rpm <= _cfg.rpm_max);
-      const bool shift_ok   = ((_cfg.mode & BF_SHIFT)   && (now_ms <= _shiftWindowUntil));
-      const bool overrun_ok = ((_cfg.mode & BF_OVERRUN) && (_drpm_per_s <= -(int32_t)_cfg.decel_thresh_rpm_s));
-
-      if (rpm_ok && (shift_ok || overrun_ok)) {
-        startPattern(now_ms);
-      }
-    }
-
-    // đang active → bắn nhịp nếu đến lượt & hệ đang không bận
-    if (_active && !_isBusy() && (now_ms >= _nextPulseAt) && _burstsLeft) {
-      _requestIgnCut(_cfg.burst_on_ms); // ON
-      _nextPulseAt = now_ms + (uint32_t)_cfg.burst_on_ms + (uint32_t)_cfg.burst_off_ms; // OFF
-      if (--_burstsLeft == 0) {
-        _patternEnd = _nextPulseAt; // kết thúc sau OFF cuối
-      }
+    if (_active || (_fired && (now_us - _lastFireAt) < (uint32_t)_cfg.refractory_ms * 1000UL)) return;
+    if (rpm < _cfg.rpm_min || rpm > _cfg.rpm_max) return;
+
+    if ((_cfg.mode & BF_SHIFT) && _shiftPending) {
+      // bắt đầu lúc QS nhả (hoặc ngay nếu đã nhả); cut QS còn chạy thì scheduler dời nhịp đầu
+      startPattern((int32_t)(_shiftAt - now_us) > 0 ? _shiftAt : now_us);
+    } else if ((_cfg.mode & BF_OVERRUN) && !_isBusy() &&
+               _drpm_per_s <= -(int32_t)_cfg.decel_thresh_rpm_s) {
+      startPattern(now_us);
     }
   }
 
-private:
-  void startPattern(uint32_t now_ms) {
-    // clamp an toàn cho rơ-le cơ
-    uint16_t on_ms  = _cfg.burst_on_ms;  if (on_ms  < 20) on_ms  = 20;
-    uint16_t off_ms = _cfg.burst_off_ms; if (off_ms < 40) off_ms = 40;
+  bool active() const { return _active; }
 
+private:
+  void startPattern(uint32_t t0_us) {
+    uint32_t off_gap_us;
+    const CUT::Timeline tl = compile(_cfg, off_gap_us);
+    _shiftPending = false;  // dùng 1 lần sau SHIFT
+    if (!_play(t0_us, tl)) return;
     _active      = true;
-    _burstsLeft  = _cfg.burst_count ? _cfg.burst_count : 1;
-    _nextPulseAt = now_ms;  // bắn ngay nhịp đầu
-    _patternEnd  = now_ms + (uint32_t)(on_ms + off_ms) * (uint32_t)_burstsLeft;
-    _lastFireAt  = now_ms;
-    _shiftWindowUntil = 0;  // dùng 1 lần sau SHIFT
+    _patternEnd  = t0_us + tl.off_us[tl.n - 1] + off_gap_us; // sau OFF cuối
+    _lastFireAt  = t0_us;
+    _fired       = true;
   }
 
   // ===== data =====
@@ -128,18 +164,22 @@ private:
 
   GetRpmFn        _getRpm        = nullptr;
   IsCutBusyFn     _isBusy        = nullptr;
-  RequestIgnCutFn _requestIgnCut = nullptr;
+  PlayTimelineFn  _play          = nullptr;
   IsIgnModeFn     _isIgnMode     = nullptr;
+  GetAccelFn      _getAccel      = nullptr;
 
   uint16_t _lastRpm = 0;
   uint32_t _lastTs  = 0;
   int32_t  _drpm_per_s = 0;
 
   bool     _active = false;
-  uint8_t  _burstsLeft = 0;
-  uint32_t _nextPulseAt = 0;
+  bool     _fired  = false;
   uint32_t _patternEnd  = 0;
   uint32_t _lastFireAt  = 0;
+  bool     _shiftPending = false;
+  uint32_t _shiftAt = 0;
   uint32_t _shiftWindowUntil = 0;
   uint32_t _startedAt = 0;
+  bool     _started = false;
+  bool     _warm = false;
 };
@@ -3,11 +3,11 @@
 
 // ===== Defaults & Limits =====
 // Modes
-enum class Mode : uint8_t { MANUAL = 0, AUTO = 1 };
+enum class Mode : uint8_t { MANUAL = 0, AUTO = 1, SPARK = 2 }; // SPARK: cắt theo số lần đánh lửa
 enum class RpmSource : uint8_t { COIL = 0, INJECTOR = 1 };
 enum class CutOutputSel : uint8_t { IGN = 0, INJ = 1 };
 
-struct AutoBand { uint16_t rpm_lo; uint16_t rpm_hi; uint16_t cut_ms; };
+struct AutoBand { uint16_t rpm_lo; uint16_t rpm_hi; uint16_t cut_ms; uint8_t pattern; }; // pattern: SKIP::PATTERNS (0 = liền, bỏ trống trong {} = 0)
 struct BackfireCfg {
   bool     enabled        = false;   // đã có
   uint16_t rpm_min        = 5000;    // đã có
@@ -22,13 +22,39 @@ struct QSConfig {
   float ppr = 1.0f;                 // 0.5 / 1 / 2 selectable
   uint16_t rpm_min = 2500;          // Below this no cut
   uint16_t manual_kill_ms = 65;     // Manual cut time (fallback)
+  uint8_t  cut_sparks = 4;          // SPARK: số sự kiện đánh lửa bị cắt
+  uint16_t spark_cut_max_ms = 120;  // SPARK: giới hạn an toàn (ms)
+  bool     cut_phase_align = true;  // bắt đầu cắt ngay trước lần đánh lửa dự báo kế tiếp
+
+  // ==== Rev limiter / launch control (cắt theo từng lần đánh lửa, trên cut_output) ====
+  bool     lim_enable    = false;
+  uint16_t lim_rpm       = 12000;   // vùng hard
+  uint16_t lim_soft_rpm  = 11700;   // vùng soft bắt đầu
+  uint16_t lim_hyst_rpm  = 100;     // trễ khi rời vùng
+  uint8_t  lim_soft_cut  = 1;       // soft: cắt 1 ...
+  uint8_t  lim_soft_of   = 3;       //       ... trên 3 lần đánh lửa
+  uint8_t  lim_hard_cut  = 1;       // hard: 1/1 = cắt hết
+  uint8_t  lim_hard_of   = 1;
+  bool     launch_enable = false;   // giữ cần số từ dưới rpm_min → giới hạn ở launch_rpm
+  uint16_t launch_rpm    = 6000;
   uint16_t debounce_shift_ms = 25;  // Shift sensor debounce
   uint16_t holdoff_ms = 180;        // Lockout after cut
   CutOutputSel cut_output = CutOutputSel::IGN; // default output
-  // Backfire (relay-simple): OFF by default per user request
-  bool backfire_enabled = false;
-  uint16_t backfire_extra_ms = 15;  // Extra cut when backfire enabled
-  uint16_t backfire_min_rpm = 4500; // Only above this rpm
+  // Backfire chuỗi nhịp (BackfireController): cắt IGN sau khi QS nhả / khi đóng ga nhanh.
+  // Thay cho backfire kiểu cũ (kéo dài cut QS thêm backfire_extra_ms): NVS "bf_en" /
+  // JSON "backfire_enabled" cũ được chuyển thành bf_enable (xem config_store.cpp).
+  bool     bf_enable        = false;
+  bool     bf_ign_only      = true;
+  uint8_t  bf_mode          = 3;      // bit0 SHIFT, bit1 OVERRUN
+  uint16_t bf_rpm_min       = 4500;
+  uint16_t bf_rpm_max       = 9000;
+  uint16_t bf_warmup_s      = 120;
+  uint16_t bf_decel_thresh  = 3000;   // rpm/s
+  uint16_t bf_window_ms     = 250;    // cửa sổ sau khi QS nhả
+  uint8_t  bf_burst_count   = 3;      // tối đa CUT::TIMELINE_MAX
+  uint16_t bf_burst_on      = 25;     // ms
+  uint16_t bf_burst_off     = 75;     // ms
+  uint16_t bf_refractory_ms = 1500;
   
   // Calibration
   float rpm_scale = 1.0f;           // rpm_display = rpm_raw * rpm_scale
@@ -55,6 +81,7 @@ struct QSConfig {
   char     ap_ssid[32]     = "";       // SSID tối đa 31 ký tự + null (sẽ được set theo MAC)
   char     ap_pass[64]     = "12345678"; // Password 8-63 ký tự (WPA2-PSK)
   uint16_t ap_timeout_s    = 120;      // 0 = never auto close
+  uint16_t tele_ms         = 100;      // chu kỳ đẩy trạng thái qua SSE /api/events (0 = tắt)
 
   // ==== Auto Cut Configuration ====
   uint16_t auto_cut_min    = 20;       // min cut time in auto mode
@@ -69,3 +96,5 @@ struct QSConfig {
 // Limits / safety
 static constexpr uint16_t CUT_MS_MAX = 150; // hard cap
 static constexpr uint16_t CUT_MS_MIN = 20;
+static constexpr uint8_t  CUT_SPARKS_MAX = 16;
+static constexpr uint16_t RPM_LOOKAHEAD_MS = 10; // tra cut map theo rpm dự báo sau 10ms
@@ -1,12 +1,28 @@
 #include "config_store.h"
 #include <Preferences.h>
 #include <ArduinoJson.h>
+#include "skip_fire.h"
+#include "Backfire.h"
 
 namespace CFG {
   Preferences prefs;
-  QSConfig g_cfg;
+
+  // Double buffer kiểu RCU: s_cur trỏ bản đang dùng, set() ghi vào bản còn lại rồi đổi
+  // con trỏ. Bản mà task loop đang ghim (s_pinned) không bao giờ bị ghi; nếu set() cần
+  // đúng bản đó thì chờ (không giới hạn) tới khi loop sang vòng mới (acquire()).
+  static QSConfig s_buf[2];
+  static QSConfig* s_cur = &s_buf[0];
+  static const QSConfig* s_pinned = nullptr;
+  static TaskHandle_t s_pin_task = nullptr;
+  static uint32_t s_ver = 0;
+  static uint32_t s_bufVer[2] = {0, 0};       // version của từng bản, ghi trước khi đổi s_cur
+  static uint32_t s_seq = 0;                  // seqlock cho get(): lẻ = đang ghi bản spare
+  static SemaphoreHandle_t s_wlock = nullptr; // tuần tự hóa các writer
+  static QSConfig &g_cfg = s_buf[0];          // chỉ dùng trong begin(), trước khi publish
 
   void begin() {
+    s_wlock = xSemaphoreCreateMutex();
+    s_cur = &s_buf[0];
     prefs.begin("qs", false);
     
     // Load existing config
@@ -26,12 +42,42 @@ namespace CFG {
     g_cfg.rpm_source = (RpmSource)prefs.getUChar("rpm_src", 0);
     g_cfg.rpm_min = prefs.getUShort("rpm_min", 1000);
     g_cfg.manual_kill_ms = prefs.getUShort("mkill", 50);
+    const uint8_t mode = prefs.getUChar("mode", (uint8_t)Mode::AUTO);
+    g_cfg.mode = (mode <= (uint8_t)Mode::SPARK) ? (Mode)mode : Mode::AUTO; // giá trị hỏng/bản mới hơn
+    g_cfg.cut_sparks = prefs.getUChar("cut_spk", 4);
+    g_cfg.spark_cut_max_ms = prefs.getUShort("spk_max", 120);
+    g_cfg.cut_phase_align = prefs.getBool("cut_align", true);
+    g_cfg.bf_enable = prefs.getBool("bf2_en", false);
+    g_cfg.bf_ign_only = prefs.getBool("bf_ign", true);
+    g_cfg.bf_mode = prefs.getUChar("bf_mode", 3);
+    g_cfg.bf_rpm_min = prefs.getUShort("bf_rmin", 4500);
+    g_cfg.bf_rpm_max = prefs.getUShort("bf_rmax", 9000);
+    g_cfg.bf_warmup_s = min<uint16_t>(prefs.getUShort("bf_warm", 120), BackfireController::WARMUP_S_MAX);
+    g_cfg.bf_decel_thresh = prefs.getUShort("bf_decel", 3000);
+    g_cfg.bf_window_ms = prefs.getUShort("bf_win", 250);
+    g_cfg.bf_burst_count = prefs.getUChar("bf_cnt", 3);
+    g_cfg.bf_burst_on = prefs.getUShort("bf_on", 25);
+    g_cfg.bf_burst_off = prefs.getUShort("bf_off", 75);
+    g_cfg.bf_refractory_ms = prefs.getUShort("bf_refr", 1500);
+    g_cfg.lim_enable = prefs.getBool("lim_en", false);
+    g_cfg.lim_rpm = prefs.getUShort("lim_rpm", 12000);
+    g_cfg.lim_soft_rpm = prefs.getUShort("lim_soft", 11700);
+    g_cfg.lim_hyst_rpm = prefs.getUShort("lim_hyst", 100);
+    g_cfg.lim_soft_cut = prefs.getUChar("lim_scut", 1);
+    g_cfg.lim_soft_of = prefs.getUChar("lim_sof", 3);
+    g_cfg.lim_hard_cut = prefs.getUChar("lim_hcut", 1);
+    g_cfg.lim_hard_of = prefs.getUChar("lim_hof", 1);
+    g_cfg.launch_enable = prefs.getBool("lch_en", false);
+    g_cfg.launch_rpm = prefs.getUShort("lch_rpm", 6000);
     g_cfg.debounce_shift_ms = prefs.getUShort("deb", 20);
     g_cfg.holdoff_ms = prefs.getUShort("hold", 200);
     g_cfg.cut_output = (CutOutputSel)prefs.getUChar("cut_out", 0);
     
-    g_cfg.backfire_enabled = prefs.getBool("bf_en", false);
-    // Backfire OFF mặc định - không load các trường cũ
+    // Backfire kiểu cũ (bf_en: kéo dài cut QS) → chuỗi nhịp SHIFT, chỉ khi chưa có bf2_en
+    if (!prefs.isKey("bf2_en") && prefs.getBool("bf_en", false)) {
+      g_cfg.bf_enable = true;
+      g_cfg.bf_mode = BackfireController::BF_SHIFT;
+    }
     
     // Load Auto Map
     int map_count = prefs.getInt("map_count", 0);
@@ -41,6 +87,7 @@ namespace CFG {
       g_cfg.map[i].rpm_lo = prefs.getUShort((key + "_lo").c_str(), 0);
       g_cfg.map[i].rpm_hi = prefs.getUShort((key + "_hi").c_str(), 0);
       g_cfg.map[i].cut_ms = prefs.getUShort((key + "_t").c_str(), 50);
+      g_cfg.map[i].pattern = prefs.getUChar((key + "_p").c_str(), 0);
     }
     
     // Load Wi-Fi AP settings
@@ -49,6 +96,7 @@ namespace CFG {
     g_cfg.ap_pass[0] = '\0';
     prefs.getString("ap_pass", g_cfg.ap_pass, sizeof(g_cfg.ap_pass));
     g_cfg.ap_timeout_s = prefs.getUShort("ap_timeout", 120);
+    g_cfg.tele_ms = prefs.getUShort("tele_ms", 100);
     
     // Tạo SSID mặc định theo MAC nếu chưa có
     if (g_cfg.ap_ssid[0] == '\0') {
@@ -58,11 +106,57 @@ namespace CFG {
       // Lưu SSID mặc định vào prefs
       prefs.putString("ap_ssid", g_cfg.ap_ssid);
     }
+    s_ver = 1; // version 0 = chưa load, để module dẫn xuất tham số ở tick đầu tiên
+    s_bufVer[0] = 1;
+  }
+
+  void acquire() {
+    s_pin_task = xTaskGetCurrentTaskHandle();
+    __atomic_store_n(&s_pinned, __atomic_load_n(&s_cur, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  }
+
+  const QSConfig& snapshot() {
+    const QSConfig* p = __atomic_load_n(&s_pinned, __ATOMIC_ACQUIRE);
+    return p ? *p : *__atomic_load_n(&s_cur, __ATOMIC_ACQUIRE);
+  }
+
+  uint32_t version() { return __atomic_load_n(&s_ver, __ATOMIC_ACQUIRE); }
+
+  // Bản đã ghim không bị ghi lại nên version của nó ổn định suốt vòng; đọc s_ver riêng thì
+  // set() chen giữa acquire() và version() sẽ gán version mới cho config cũ.
+  uint32_t pinnedVersion() {
+    const QSConfig* p = &snapshot();
+    return __atomic_load_n(&s_bufVer[p - s_buf], __ATOMIC_ACQUIRE);
+  }
+
+  // false nếu bản spare đang bị task loop ghim (set() 2 lần trong 1 vòng loop): không bao giờ
+  // ghi đè bản đó, người gọi chờ loop sang vòng mới (acquire()) rồi thử lại.
+  static bool publish(const QSConfig& cfg) {
+    QSConfig* cur   = s_cur;
+    QSConfig* spare = (cur == &s_buf[0]) ? &s_buf[1] : &s_buf[0];
+    const bool self = (xTaskGetCurrentTaskHandle() == s_pin_task);
+    if (!self && __atomic_load_n(&s_pinned, __ATOMIC_ACQUIRE) == spare) return false;
+    __atomic_add_fetch(&s_seq, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    *spare = cfg;
+    const uint32_t ver = __atomic_add_fetch(&s_ver, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_bufVer[spare - s_buf], ver, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_cur, spare, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&s_seq, 1, __ATOMIC_RELEASE);
+    // chính task loop ghi (lock guard): ghim luôn bản mới, set() kế tiếp ghi sang bản kia
+    if (self) __atomic_store_n(&s_pinned, spare, __ATOMIC_RELEASE);
+    return true;
   }
 
   void set(const QSConfig& cfg) {
-    g_cfg = cfg;
-    
+    // Nhả khóa writer trong lúc chờ: task loop có thể đang chờ chính khóa này (set() của
+    // lock guard) và chỉ bỏ ghim khi chạy tiếp tới acquire() của vòng sau.
+    for (;;) {
+      if (s_wlock) xSemaphoreTake(s_wlock, portMAX_DELAY);
+      if (publish(cfg)) break;
+      if (s_wlock) xSemaphoreGive(s_wlock);
+      vTaskDelay(pdMS_TO_TICKS(1));
+    }
     prefs.putBool("lock_en", cfg.lock_enabled);
     prefs.putString("lock_code", cfg.lock_code);
     prefs.putUChar("lock_cut", (uint8_t)cfg.lock_cut_sel);
@@ -78,12 +172,37 @@ namespace CFG {
     prefs.putUChar("rpm_src", (uint8_t)cfg.rpm_source);
     prefs.putUShort("rpm_min", cfg.rpm_min);
     prefs.putUShort("mkill", cfg.manual_kill_ms);
+    prefs.putUChar("mode", (uint8_t)cfg.mode);
+    prefs.putUChar("cut_spk", cfg.cut_sparks);
+    prefs.putUShort("spk_max", cfg.spark_cut_max_ms);
+    prefs.putBool("cut_align", cfg.cut_phase_align);
+    prefs.putBool("bf2_en", cfg.bf_enable);
+    prefs.putBool("bf_ign", cfg.bf_ign_only);
+    prefs.putUChar("bf_mode", cfg.bf_mode);
+    prefs.putUShort("bf_rmin", cfg.bf_rpm_min);
+    prefs.putUShort("bf_rmax", cfg.bf_rpm_max);
+    prefs.putUShort("bf_warm", cfg.bf_warmup_s);
+    prefs.putUShort("bf_decel", cfg.bf_decel_thresh);
+    prefs.putUShort("bf_win", cfg.bf_window_ms);
+    prefs.putUChar("bf_cnt", cfg.bf_burst_count);
+    prefs.putUShort("bf_on", cfg.bf_burst_on);
+    prefs.putUShort("bf_off", cfg.bf_burst_off);
+    prefs.putUShort("bf_refr", cfg.bf_refractory_ms);
+    prefs.putBool("lim_en", cfg.lim_enable);
+    prefs.putUShort("lim_rpm", cfg.lim_rpm);
+    prefs.putUShort("lim_soft", cfg.lim_soft_rpm);
+    prefs.putUShort("lim_hyst", cfg.lim_hyst_rpm);
+    prefs.putUChar("lim_scut", cfg.lim_soft_cut);
+    prefs.putUChar("lim_sof", cfg.lim_soft_of);
+    prefs.putUChar("lim_hcut", cfg.lim_hard_cut);
+    prefs.putUChar("lim_hof", cfg.lim_hard_of);
+    prefs.putBool("lch_en", cfg.launch_enable);
+    prefs.putUShort("lch_rpm", cfg.launch_rpm);
     prefs.putUShort("deb", cfg.debounce_shift_ms);
     prefs.putUShort("hold", cfg.holdoff_ms);
     prefs.putUChar("cut_out", (uint8_t)cfg.cut_output);
     
-    prefs.putBool("bf_en", cfg.backfire_enabled);
-    // Backfire OFF mặc định - không save các trường cũ
+    prefs.remove("bf_en");   // khoá backfire cũ, đã chuyển sang bf2_en
     
     // Save Auto Map
     prefs.putInt("map_count", cfg.map_count);
@@ -92,61 +211,102 @@ namespace CFG {
       prefs.putUShort((key + "_lo").c_str(), cfg.map[i].rpm_lo);
       prefs.putUShort((key + "_hi").c_str(), cfg.map[i].rpm_hi);
       prefs.putUShort((key + "_t").c_str(), cfg.map[i].cut_ms);
+      prefs.putUChar((key + "_p").c_str(), cfg.map[i].pattern);
     }
     
     // Save Wi-Fi AP settings
     prefs.putString("ap_ssid", cfg.ap_ssid);
     prefs.putString("ap_pass", cfg.ap_pass);
     prefs.putUShort("ap_timeout", cfg.ap_timeout_s);
+    prefs.putUShort("tele_ms", cfg.tele_ms);
+    if (s_wlock) xSemaphoreGive(s_wlock);
   }
 
   QSConfig get() {
-    return g_cfg;
+    // copy rồi kiểm tra seq: chỉ set() thứ 2 trong lúc copy mới ghi vào bản đang đọc.
+    // seq lẻ = writer đang copy: ngủ 1 tick chứ không taskYIELD() — trên C3 lõi đơn, reader ưu
+    // tiên cao hơn (async_tcp) chiếm CPU của writer ưu tiên thấp (loop) thì yield không bao giờ
+    // trả CPU cho writer.
+    for (;;) {
+      const uint32_t q = __atomic_load_n(&s_seq, __ATOMIC_ACQUIRE);
+      if (q & 1) { vTaskDelay(1); continue; }
+      QSConfig c = *__atomic_load_n(&s_cur, __ATOMIC_ACQUIRE);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&s_seq, __ATOMIC_ACQUIRE) == q) return c;
+    }
   }
 
   bool exportJSON(String &out, bool includeSecret) {
+    const QSConfig c = get();
     JsonDocument d;
     
-    d["lock_enabled"]        = g_cfg.lock_enabled;
-    d["lock_code"]           = includeSecret ? g_cfg.lock_code : "***"; // Chỉ trả password khi includeSecret = true
-    d["lock_cut_sel"]        = (uint8_t)g_cfg.lock_cut_sel;
-    d["lock_short_ms_max"]   = g_cfg.lock_short_ms_max;
-    d["lock_long_ms_min"]    = g_cfg.lock_long_ms_min;
-    d["lock_gap_ms"]         = g_cfg.lock_gap_ms;
-    d["lock_timeout_s"]      = g_cfg.lock_timeout_s;
-    d["lock_max_retries"]    = g_cfg.lock_max_retries;
-    
-    d["auto_cut_min"]        = g_cfg.auto_cut_min;
-    d["auto_cut_max"]        = g_cfg.auto_cut_max;
-    d["ppr"]                 = g_cfg.ppr;
-    d["rpm_source"]          = (uint8_t)g_cfg.rpm_source;
-    d["rpm_min"]             = g_cfg.rpm_min;
-    d["manual_kill_ms"]      = g_cfg.manual_kill_ms;
-    d["debounce_shift_ms"]   = g_cfg.debounce_shift_ms;
-    d["holdoff_ms"]          = g_cfg.holdoff_ms;
-    d["cut_output"]          = (uint8_t)g_cfg.cut_output;
-    
-    d["backfire_enabled"]    = g_cfg.backfire_enabled;
-    // Backfire OFF mặc định - không export các trường cũ
+    d["lock_enabled"]        = c.lock_enabled;
+    d["lock_code"]           = includeSecret ? c.lock_code : "***"; // Chỉ trả password khi includeSecret = true
+    d["lock_cut_sel"]        = (uint8_t)c.lock_cut_sel;
+    d["lock_short_ms_max"]   = c.lock_short_ms_max;
+    d["lock_long_ms_min"]    = c.lock_long_ms_min;
+    d["lock_gap_ms"]         = c.lock_gap_ms;
+    d["lock_timeout_s"]      = c.lock_timeout_s;
+    d["lock_max_retries"]    = c.lock_max_retries;
+    
+    d["auto_cut_min"]        = c.auto_cut_min;
+    d["auto_cut_max"]        = c.auto_cut_max;
+    d["ppr"]                 = c.ppr;
+    d["rpm_source"]          = (uint8_t)c.rpm_source;
+    d["rpm_min"]             = c.rpm_min;
+    d["manual_kill_ms"]      = c.manual_kill_ms;
+    d["mode"]                = (uint8_t)c.mode;
+    d["cut_sparks"]          = c.cut_sparks;
+    d["spark_cut_max_ms"]    = c.spark_cut_max_ms;
+    d["cut_phase_align"]     = c.cut_phase_align;
+    d["bf_enable"]           = c.bf_enable;
+    d["bf_ign_only"]         = c.bf_ign_only;
+    d["bf_mode"]             = c.bf_mode;
+    d["bf_rpm_min"]          = c.bf_rpm_min;
+    d["bf_rpm_max"]          = c.bf_rpm_max;
+    d["bf_warmup_s"]         = c.bf_warmup_s;
+    d["bf_decel_thresh"]     = c.bf_decel_thresh;
+    d["bf_window_ms"]        = c.bf_window_ms;
+    d["bf_burst_count"]      = c.bf_burst_count;
+    d["bf_burst_on"]         = c.bf_burst_on;
+    d["bf_burst_off"]        = c.bf_burst_off;
+    d["bf_refractory_ms"]    = c.bf_refractory_ms;
+    d["lim_enable"]          = c.lim_enable;
+    d["lim_rpm"]             = c.lim_rpm;
+    d["lim_soft_rpm"]        = c.lim_soft_rpm;
+    d["lim_hyst_rpm"]        = c.lim_hyst_rpm;
+    d["lim_soft_cut"]        = c.lim_soft_cut;
+    d["lim_soft_of"]         = c.lim_soft_of;
+    d["lim_hard_cut"]        = c.lim_hard_cut;
+    d["lim_hard_of"]         = c.lim_hard_of;
+    d["launch_enable"]       = c.launch_enable;
+    d["launch_rpm"]          = c.launch_rpm;
+    d["debounce_shift_ms"]   = c.debounce_shift_ms;
+    d["holdoff_ms"]          = c.holdoff_ms;
+    d["cut_output"]          = (uint8_t)c.cut_output;
+    
     
     // Auto Map
     JsonArray mapArray = d["map"].to<JsonArray>();
-    for (int i = 0; i < g_cfg.map_count; i++) {
+    for (int i = 0; i < c.map_count; i++) {
       JsonObject mapItem = mapArray.add<JsonObject>();
-      mapItem["lo"] = g_cfg.map[i].rpm_lo;
-      mapItem["hi"] = g_cfg.map[i].rpm_hi;
-      mapItem["t"] = g_cfg.map[i].cut_ms;
+      mapItem["lo"] = c.map[i].rpm_lo;
+      mapItem["hi"] = c.map[i].rpm_hi;
+      mapItem["t"] = c.map[i].cut_ms;
+      mapItem["p"] = c.map[i].pattern;
     }
     
     // Wi-Fi AP settings
-    d["ap_ssid"]             = g_cfg.ap_ssid;
-    d["ap_pass"]             = includeSecret ? g_cfg.ap_pass : "***"; // Chỉ trả password khi includeSecret = true
-    d["ap_timeout_s"]        = g_cfg.ap_timeout_s;
+    d["ap_ssid"]             = c.ap_ssid;
+    d["ap_pass"]             = includeSecret ? c.ap_pass : "***"; // Chỉ trả password khi includeSecret = true
+    d["ap_timeout_s"]        = c.ap_timeout_s;
+    d["tele_ms"]             = c.tele_ms;
     
     // Lock status (runtime)
-    d["vehicle_locked"]      = g_cfg.vehicle_locked;
-    d["has_password"]        = g_cfg.has_password;
+    d["vehicle_locked"]      = c.vehicle_locked;
+    d["has_password"]        = c.has_password;
     
+    out.reserve(measureJson(d) + 1); // 1 lần cấp phát thay vì String nở dần
     return serializeJson(d, out) > 0;
   }
 
@@ -154,8 +314,13 @@ namespace CFG {
     JsonDocument d;
     DeserializationError e = deserializeJson(d, json);
     if (e) return false;
+    return importJSON(d.as<JsonVariantConst>());
+  }
+
+  bool importJSON(JsonVariantConst d) {
+    if (!d.is<JsonObjectConst>()) return false;
     
-    QSConfig c = g_cfg; // Copy current config
+    QSConfig c = get(); // Copy current config
     
     if (d["lock_enabled"].is<bool>()) c.lock_enabled = d["lock_enabled"];
     if (d["lock_code"].is<String>()) {
@@ -184,24 +349,57 @@ namespace CFG {
     if (d["rpm_source"].is<uint8_t>()) c.rpm_source = (RpmSource)d["rpm_source"].as<uint8_t>();
     if (d["rpm_min"].is<uint16_t>()) c.rpm_min = d["rpm_min"];
     if (d["manual_kill_ms"].is<uint16_t>()) c.manual_kill_ms = d["manual_kill_ms"];
+    if (d["mode"].is<uint8_t>() && d["mode"].as<uint8_t>() <= (uint8_t)Mode::SPARK) c.mode = (Mode)d["mode"].as<uint8_t>();
+    if (d["cut_sparks"].is<uint8_t>()) c.cut_sparks = constrain(d["cut_sparks"].as<uint8_t>(), (uint8_t)1, CUT_SPARKS_MAX);
+    if (d["cut_phase_align"].is<bool>()) c.cut_phase_align = d["cut_phase_align"];
+    // UI gửi bool dạng 0/1
+    if (!d["bf_enable"].isNull()) c.bf_enable = d["bf_enable"].as<bool>();
+    if (!d["bf_ign_only"].isNull()) c.bf_ign_only = d["bf_ign_only"].as<bool>();
+    if (d["bf_mode"].is<uint8_t>()) c.bf_mode = d["bf_mode"].as<uint8_t>() & 0x03;
+    if (d["bf_rpm_min"].is<uint16_t>()) c.bf_rpm_min = d["bf_rpm_min"];
+    if (d["bf_rpm_max"].is<uint16_t>()) c.bf_rpm_max = d["bf_rpm_max"];
+    if (d["bf_warmup_s"].is<uint16_t>()) c.bf_warmup_s = min<uint16_t>(d["bf_warmup_s"].as<uint16_t>(), BackfireController::WARMUP_S_MAX);
+    if (d["bf_decel_thresh"].is<uint16_t>()) c.bf_decel_thresh = d["bf_decel_thresh"];
+    if (d["bf_window_ms"].is<uint16_t>()) c.bf_window_ms = d["bf_window_ms"];
+    if (d["bf_burst_count"].is<uint8_t>()) c.bf_burst_count = constrain<uint8_t>(d["bf_burst_count"].as<uint8_t>(), 1, CUT::TIMELINE_MAX);
+    if (d["bf_burst_on"].is<uint16_t>()) c.bf_burst_on = d["bf_burst_on"];
+    if (d["bf_burst_off"].is<uint16_t>()) c.bf_burst_off = d["bf_burst_off"];
+    if (d["bf_refractory_ms"].is<uint16_t>()) c.bf_refractory_ms = d["bf_refractory_ms"];
+    if (d["lim_enable"].is<bool>()) c.lim_enable = d["lim_enable"];
+    if (d["lim_rpm"].is<uint16_t>()) c.lim_rpm = d["lim_rpm"];
+    if (d["lim_soft_rpm"].is<uint16_t>()) c.lim_soft_rpm = d["lim_soft_rpm"];
+    if (d["lim_hyst_rpm"].is<uint16_t>()) c.lim_hyst_rpm = d["lim_hyst_rpm"];
+    if (d["lim_soft_of"].is<uint8_t>()) c.lim_soft_of = max<uint8_t>(1, d["lim_soft_of"].as<uint8_t>());
+    if (d["lim_soft_cut"].is<uint8_t>()) c.lim_soft_cut = min<uint8_t>(c.lim_soft_of, d["lim_soft_cut"].as<uint8_t>());
+    if (d["lim_hard_of"].is<uint8_t>()) c.lim_hard_of = max<uint8_t>(1, d["lim_hard_of"].as<uint8_t>());
+    if (d["lim_hard_cut"].is<uint8_t>()) c.lim_hard_cut = min<uint8_t>(c.lim_hard_of, d["lim_hard_cut"].as<uint8_t>());
+    if (d["launch_enable"].is<bool>()) c.launch_enable = d["launch_enable"];
+    if (d["launch_rpm"].is<uint16_t>()) c.launch_rpm = d["launch_rpm"];
+    if (c.lim_soft_rpm > c.lim_rpm) c.lim_soft_rpm = c.lim_rpm;
+    if (d["spark_cut_max_ms"].is<uint16_t>()) c.spark_cut_max_ms = constrain(d["spark_cut_max_ms"].as<uint16_t>(), CUT_MS_MIN, CUT_MS_MAX);
     if (d["debounce_shift_ms"].is<uint16_t>()) c.debounce_shift_ms = d["debounce_shift_ms"];
     if (d["holdoff_ms"].is<uint16_t>()) c.holdoff_ms = d["holdoff_ms"];
     if (d["cut_output"].is<uint8_t>()) c.cut_output = (CutOutputSel)d["cut_output"].as<uint8_t>();
     
-    if (d["backfire_enabled"].is<bool>()) c.backfire_enabled = d["backfire_enabled"];
-    // Backfire OFF mặc định - không import các trường cũ
+    // file config cũ: backfire_enabled → chuỗi nhịp SHIFT (bf_enable có mặt thì bỏ qua)
+    if (d["bf_enable"].isNull() && d["backfire_enabled"].is<bool>() && d["backfire_enabled"].as<bool>()) {
+      c.bf_enable = true;
+      c.bf_mode = BackfireController::BF_SHIFT;
+    }
     
     // Auto Map
-    if (d["map"].is<JsonArray>()) {
-      JsonArray mapArray = d["map"];
+    if (d["map"].is<JsonArrayConst>()) {
+      JsonArrayConst mapArray = d["map"];
       c.map_count = 0;
       int index = 0;
-      for (JsonObject mapItem : mapArray) {
+      for (JsonObjectConst mapItem : mapArray) {
         if (index >= 4) break; // Max 4 items
         if (mapItem["lo"].is<uint16_t>() && mapItem["hi"].is<uint16_t>() && mapItem["t"].is<uint16_t>()) {
           c.map[index].rpm_lo = mapItem["lo"];
           c.map[index].rpm_hi = mapItem["hi"];
           c.map[index].cut_ms = mapItem["t"];
+          const uint8_t pt = mapItem["p"] | 0;
+          c.map[index].pattern = pt < SKIP::COUNT ? pt : SKIP::SOLID;
           index++;
           c.map_count++;
         }
@@ -231,6 +429,7 @@ namespace CFG {
       // Nếu không hợp lệ, giữ password cũ
     }
     if (d["ap_timeout_s"].is<uint16_t>()) c.ap_timeout_s = d["ap_timeout_s"];
+    if (d["tele_ms"].is<uint16_t>()) { const uint16_t v = d["tele_ms"]; c.tele_ms = v ? constrain<uint16_t>(v, 50, 2000) : 0; }
     
     set(c);
     return true;
@@ -1,11 +1,21 @@
 #pragma once
 #include <Arduino.h>
+#include <ArduinoJson.h>
 #include "config.h"
 
 namespace CFG {
   void begin();
-  QSConfig get();
-  void set(const QSConfig& cfg);
+  QSConfig get();                 // bản copy, gọi được từ mọi task (web, lock...)
+  void set(const QSConfig& cfg);  // publish bản mới (đổi con trỏ nguyên tử) rồi lưu NVS
+
+  // ---- Hot path (chỉ trong task loop) ----
+  // acquire(): gọi ĐẦU mỗi vòng loop() — ghim bản config hiện tại cho cả vòng.
+  // snapshot(): tham chiếu tới bản đã ghim, không copy, không bị set() ghi đè giữa vòng.
+  void acquire();
+  const QSConfig& snapshot();
+  uint32_t version();             // tăng mỗi lần set()
+  uint32_t pinnedVersion();       // version của đúng bản snapshot() đang ghim — dùng để phát hiện đổi config
   bool exportJSON(String &out, bool includeSecret = false);
   bool importJSON(const String& json);
+  bool importJSON(JsonVariantConst d); // object đã parse sẵn (web parse body 1 lần rồi gọi thẳng)
 }
@@ -3,10 +3,18 @@
 #include "rpm_rmt.h"
 #include "trigger_input.h"
 #include "cut_output.h"
+#include "cut_timer.h"
 #include "log_ring.h"
 #include "pins.h"
 #include "pwm_test.h"
 #include "lock_guard.h"
+#include "cut_map.h"
+#include "skip_fire.h"
+#include "rev_limiter.h"
+#include "scope_trace.h"
+#include "persist_log.h"
+#include "phase_align.h"
+#include "Backfire.h"
 
 static State st = State::IDLE; 
 static uint32_t tEntry=0; 
@@ -15,24 +23,107 @@ static bool armedEdge=false;
 static uint32_t lastCutTime=0;        // Thời điểm cắt cuối cùng
 static uint16_t holdoffRemainMs=0;    // Thời gian holdoff còn lại
 static const char* cutReason="ok";    // Lý do cắt/không cắt
+static uint32_t edgeUs=0;             // timestamp cạnh trigger đang xử lý (µs)
+static bool launchHold=false;         // cần số được giữ từ dưới rpm_min → launch control
+static void (*s_cutHook)(uint32_t)=nullptr;
 
-static uint16_t lookupCut(uint16_t rpm, const QSConfig &c){
-  // manual
-  if (c.mode==Mode::MANUAL) return c.manual_kill_ms;
-  // auto (linear between bands)
-  for (uint8_t i=0;i<c.map_count;i++){
-    auto b=c.map[i];
-    if (rpm>=b.rpm_lo && rpm<b.rpm_hi) return b.cut_ms;
-  }
-  // above last band: use last
-  return c.map[c.map_count-1].cut_ms;
+// Kế hoạch cắt cho cạnh trigger kế tiếp, tính sẵn ở mỗi tick
+// cut_us: độ dài xung (SPARK: giới hạn dự phòng), sparks: số cạnh đánh lửa để nhả (0 = theo thời gian)
+// per: chu kỳ cạnh lúc lập kế hoạch, align: đặt điểm bắt đầu ngay trước lần đánh lửa kế tiếp
+// pmask/plen: mẫu skip-fire của band (plen = 0 → xung liền)
+struct CutPlan { uint16_t cut_ms; uint32_t cut_us; uint8_t sparks; bool useIgn; bool bf; uint32_t per; bool align;
+                 uint32_t pmask; uint8_t plen; };
+
+// ===== Cắt theo số lần đánh lửa (Mode::SPARK) =====
+// Hook trong ISR capture đếm cạnh RPM hợp lệ, nhả cut QS ở cạnh thứ N. Xung cắt vẫn được
+// hẹn nhả theo thời gian (N+½ chu kỳ, chặn bởi spark_cut_max_ms) phòng khi cạnh biến mất
+// trong lúc cắt (lấy rpm từ chính dây coil bị cắt).
+static volatile uint8_t s_sparkLeft = 0;
+static volatile uint8_t s_sparkLine = 0;
+static volatile uint32_t s_sparkRel = 0;     // số lần nhả bằng đếm cạnh
+static volatile uint32_t s_lastEdgeUs = 0;   // cạnh đánh lửa gần nhất (dự báo pha)
+
+static void IRAM_ATTR onSparkEdge(uint32_t t_us){
+  LIMIT::onEdge(t_us);
+  SKIP::onEdge(t_us);
+  SCOPE::onEdge(t_us);
+  s_lastEdgeUs = t_us;
+  uint8_t n = s_sparkLeft;
+  if (!n) return;
+  s_sparkLeft = --n;
+  if (n == 0) { CUT::cancel((CutLine)s_sparkLine, CutPrio::QS); s_sparkRel = s_sparkRel + 1; }
+}
+
+static inline void IRAM_ATTR sparkStart(bool ign, uint8_t n){ s_sparkLine = ign ? (uint8_t)CutLine::IGN : (uint8_t)CutLine::INJ; s_sparkLeft = n; }
+
+static volatile uint32_t s_cutReqUs = 0, s_cutStartUs = 0; // cut gần nhất: lúc quyết định / lúc bắt đầu
+
+// Dùng chung cho ISR trigger và loop. false = PLOG đang ghi flash (CUT::flashLocked()): chưa
+// cắt gì, bên gọi thử lại sau. Kiểm tra và giữ cửa sổ trong critical section của CUT nên
+// PLOG không thể khoá xen giữa; cả cửa sổ QS (kể cả các bước skip-fire hẹn theo cạnh sau
+// này) được reserve() để PLOG không ghi trước khi xung kết thúc. CUTTMR::enter() lồng được
+// (requestAt()/reserve() vào lại cùng critical section).
+static bool IRAM_ATTR startCut(bool ign, uint32_t cut_us, uint8_t sparks, uint32_t per, bool align,
+                               uint32_t pmask, uint8_t plen){
+  CUTTMR::enter();
+  if (CUT::flashLocked()) { CUTTMR::exit(); return false; }
+  const uint32_t now = CUT::nowUs();
+  uint32_t next = 0;
+  const bool pred = PHASE::predictNext(s_lastEdgeUs, now, per, next);
+  const uint32_t start = align ? PHASE::startAt(now, pred, next) : now;
+  const CutLine line = ign ? CutLine::IGN : CutLine::INJ;
+  CUT::reserve(start + cut_us);
+  sparkStart(ign, 0);
+  if (plen) SKIP::start(line, pmask, plen, start, cut_us, pred ? per : 0, next);
+  else { SKIP::stop(); CUT::requestAt(line, CutPrio::QS, start, cut_us); }
+  sparkStart(ign, sparks);
+  s_cutReqUs = now; s_cutStartUs = start;
+  CUTTMR::exit();
+  return true;
+}
+
+// ===== Fast path: ISR trigger bắt đầu cắt trực tiếp =====
+// tick() công bố kế hoạch + cờ armed (chỉ khi IDLE, đủ rpm); ISR dùng kế hoạch đó và gọi
+// CUT::pulse_us() ngay trong ngắt. s_fastArmSeq gắn cờ với số lần đã bắn để tick() không
+// vô tình arm lại sau khi ISR vừa bắn mà loop chưa kịp thấy.
+static volatile bool     s_fastArmed = false;
+static volatile uint32_t s_fastArmSeq = 0;
+static volatile uint32_t s_fastSeq = 0;      // ISR tăng mỗi lần bắn
+static volatile uint32_t s_fastEdgeUs = 0, s_fastCutUs = 0;
+static volatile bool     s_fastIgn = true;
+static volatile uint8_t  s_fastSparks = 0;
+static volatile uint32_t s_fastPer = 0;
+static volatile bool     s_fastAlign = false;
+static volatile uint32_t s_fastPMask = 0;
+static volatile uint8_t  s_fastPLen = 0;
+static CutPlan  s_fastPlan{};                // kế hoạch đã arm (loop đọc lại khi ghi log)
+static uint32_t s_fastSeen = 0;
+
+// Độ trễ trigger → lệnh cắt, và khoảng lùi có chủ đích do căn pha
+static uint32_t s_latCnt=0, s_latLast=0, s_latMax=0, s_latFast=0, s_alignLast=0;
+static uint64_t s_latSum=0, s_alignSum=0;
+
+static void latRecord(uint32_t us, uint32_t align_us, bool fast){
+  s_latLast = us; if (us > s_latMax) s_latMax = us;
+  s_latSum += us; s_latCnt++; if (fast) s_latFast++;
+  s_alignLast = align_us; s_alignSum += align_us;
 }
 
-static void pushLog(uint16_t rpm, uint16_t cut, bool autoMode, bool bf, CutOutputSel sel, const char* why){
-  LogItem it{}; it.ts_ms=millis(); it.rpm=rpm; it.cut_ms=cut; it.auto_mode=autoMode; it.backfire=bf; strncpy(it.out,(sel==CutOutputSel::IGN?"IGN":"INJ"),3); strncpy(it.reason, why, 7); LOGR::push(it);
+static bool IRAM_ATTR onShiftEdge(uint32_t t_us){
+  if (!s_fastArmed || s_fastArmSeq != s_fastSeq || LOCK::isLocked()) return false;
+  s_fastArmed = false;
+  // PLOG đang ghi flash → không bắn từ ISR, cạnh được chốt cho loop (chờ ở ARMED)
+  if (!startCut(s_fastIgn, s_fastCutUs, s_fastSparks, s_fastPer, s_fastAlign, s_fastPMask, s_fastPLen)) return false;
+  s_fastEdgeUs = t_us;
+  s_fastSeq = s_fastSeq + 1;
+  return true;
 }
 
-void CTRL::begin(){ st=State::IDLE; tEntry=millis(); }
+static void pushLog(uint16_t rpm, uint16_t cut, bool autoMode, bool bf, CutOutputSel sel, LogWhy why){
+  LogItem it{}; it.ts_ms=millis(); it.rpm=rpm; it.cut_ms=cut; it.auto_mode=autoMode; it.backfire=bf; it.out=(sel==CutOutputSel::IGN?LogOut::IGN:LogOut::INJ); it.why=why; LOGR::push(it); PLOG::logCut(it);
+}
+
+void CTRL::begin(){ SCOPE::begin(); st=State::IDLE; tEntry=millis(); TRIG::setEdgeHook(onShiftEdge); RPM::setEdgeHook(onSparkEdge); }
 
 // ===== Debug functions =====
 uint16_t CTRL::getCurrentRPM() { return RPM::get(); }
@@ -47,28 +138,97 @@ const char* CTRL::getCurrentState() {
 }
 uint16_t CTRL::getLastCutMs() { return lastCut; }
 uint16_t CTRL::getHoldoffRemainMs() { return holdoffRemainMs; }
+// Tham số dẫn xuất từ config: chỉ dựng lại khi CFG::pinnedVersion() đổi, không so từng trường.
+// rpm_min đọc được từ task web (canCutNow) nên tách riêng, ghi nguyên tử 16-bit.
+static uint32_t s_cfgVer = 0;
+static volatile uint16_t s_rpmMin = 0;
+
+static void applyConfig(const QSConfig& cfg){
+  RPM::configure(cfg.ppr, cfg.rpm_scale);               // tính lại hằng số chia
+  RPM::setInjector(cfg.rpm_source == RpmSource::INJECTOR);
+  CUTMAP::build(cfg);
+  s_rpmMin = cfg.rpm_min;
+  TRIG::setDebounce(cfg.debounce_shift_ms);  // lockout sau cạnh, không trễ trước cạnh
+
+  LIMIT::Params lp{};
+  lp.enable = cfg.lim_enable;
+  lp.hard_rpm = cfg.lim_rpm; lp.soft_rpm = cfg.lim_soft_rpm; lp.hyst_rpm = cfg.lim_hyst_rpm;
+  lp.soft_cut = cfg.lim_soft_cut; lp.soft_of = cfg.lim_soft_of;
+  lp.hard_cut = cfg.lim_hard_cut; lp.hard_of = cfg.lim_hard_of;
+  lp.launch_enable = cfg.launch_enable; lp.launch_rpm = cfg.launch_rpm;
+  lp.line = (cfg.cut_output == CutOutputSel::IGN) ? CutLine::IGN : CutLine::INJ;
+  lp.rpm_on_line = cfg.rpm_source == RpmSource::COIL && lp.line == CutLine::IGN;
+  if (!LIMIT::configure(lp, RPM::rpmConst())) Serial.println("[LIMIT] rpm source COIL + IGN cut: limiter disabled");
+}
+
+static CutPlan planCut(const QSConfig& cfg, uint16_t rpm){
+  CutPlan p{};
+  // tra map theo rpm dự báo tại lúc cut có hiệu lực (bù tăng/giảm tốc)
+  const uint16_t rpm_est = RPM::predict(RPM_LOOKAHEAD_MS);
+  uint16_t cut = CUTMAP::lookup(rpm_est ? rpm_est : rpm);
+  const SKIP::Pattern& pt = SKIP::PATTERNS[CUTMAP::pattern(rpm_est ? rpm_est : rpm)];
+  p.pmask = pt.mask; p.plen = pt.len;
+  p.useIgn = (cfg.cut_output==CutOutputSel::IGN);
+  // chỉ đánh dấu log: chuỗi nhịp SHIFT sẽ theo sau cut này (BackfireController, main.cpp)
+  p.bf = cfg.bf_enable && (cfg.bf_mode & BackfireController::BF_SHIFT) &&
+         rpm >= cfg.bf_rpm_min && rpm <= cfg.bf_rpm_max && (p.useIgn || !cfg.bf_ign_only);
+  p.cut_ms = constrain(cut, CUT_MS_MIN, CUT_MS_MAX);
+  p.cut_us = (uint32_t)p.cut_ms * 1000UL;
+  p.per = RPM::periodUs();
+  p.align = cfg.cut_phase_align;
+
+  if (cfg.mode == Mode::SPARK) {
+    p.sparks = constrain<uint8_t>(cfg.cut_sparks, 1, CUT_SPARKS_MAX);
+    const uint32_t cap = (uint32_t)constrain(cfg.spark_cut_max_ms, CUT_MS_MIN, CUT_MS_MAX) * 1000UL;
+    const uint32_t per = p.per;
+    const uint32_t est = per ? per * p.sparks + per / 2 : cap;
+    p.cut_us = constrain<uint32_t>(est, (uint32_t)CUT_MS_MIN * 1000UL, cap);
+    p.cut_ms = (uint16_t)(p.cut_us / 1000UL);
+  }
+  return p;
+}
+
+static void onCutStarted(const QSConfig& cfg, uint16_t rpm, const CutPlan& p, bool fast){
+  lastCut = p.cut_ms;
+  lastCutTime = millis();
+  latRecord(s_cutReqUs - edgeUs, s_cutStartUs - s_cutReqUs, fast);
+  pushLog(rpm, p.cut_ms, cfg.mode==Mode::AUTO, p.bf, cfg.cut_output, LogWhy::SHIFT);
+  if (s_cutHook) s_cutHook(s_cutStartUs + p.cut_us);
+  SCOPE::trigger(edgeUs, p.cut_ms, rpm, RPM::rpmConst());
+  cutReason="cutting";
+  st=State::RECOVER; 
+  tEntry=millis();
+}
+
 bool CTRL::canCutNow() { 
-  QSConfig cfg = CFG::get();
   uint16_t rpm = RPM::get();
-  return (rpm >= cfg.rpm_min) && (st == State::IDLE);
+  return (rpm >= s_rpmMin) && (st == State::IDLE);
 }
 const char* CTRL::getCutReason() { return cutReason; }
 
 void CTRL::tick(){
 
-  QSConfig cfg = CFG::get();
-
-  // Update RPM helpers
-  RPM::setPPR(cfg.ppr); 
-  RPM::setScale(cfg.rpm_scale);
+  // snapshot đã được ghim ở đầu loop(): tham chiếu ổn định suốt tick, không copy
+  const QSConfig& cfg = CFG::snapshot();
+  const uint32_t ver = CFG::pinnedVersion();
+  if (ver != s_cfgVer) { s_cfgVer = ver; applyConfig(cfg); }
   const uint16_t rpm = RPM::get();
   
   // Software tick for PWM test generator
   PWMTEST::tick();
+  SCOPE::tick();
+
+  // ISR đã bắn cut trực tiếp từ cạnh trigger → chỉ còn ghi nhận
+  const uint32_t fseq = s_fastSeq;
+  if (fseq != s_fastSeen) {
+    s_fastSeen = fseq;
+    edgeUs = s_fastEdgeUs;
+    onCutStarted(cfg, rpm, s_fastPlan, true);
+  }
 
   switch(st){
     case State::IDLE:
-      if (TRIG::pressed()) { 
+      if (TRIG::take(&edgeUs)) { 
         st=State::ARMED; 
         tEntry=millis(); 
         armedEdge=true; 
@@ -80,45 +240,71 @@ void CTRL::tick(){
       bool ok = (rpm >= cfg.rpm_min);
       if (!ok) { 
         cutReason="below_rpm_min";
+        launchHold = cfg.launch_enable; // nhấn giữ lúc đứng yên = arm launch
         st=State::IDLE; 
         break; 
       }
       
       // proceed to CUT
-      st=State::CUT; 
-      tEntry=millis();
-      cutReason="cutting";
+      const CutPlan p = planCut(cfg, rpm);
       
-      uint16_t cut = lookupCut(rpm, cfg);
-      bool useIgn = (cfg.cut_output==CutOutputSel::IGN);
-      bool bf = false;
-      if (cfg.backfire_enabled && rpm >= cfg.backfire_min_rpm){
-        bf = true; 
-        useIgn = true; // force IGN to keep fuel flowing
-        cut = min<uint16_t>(CUT_MS_MAX, (uint16_t)(cut + cfg.backfire_extra_ms));
+      // Do cut (non-blocking); flash đang ghi thì giữ ARMED, thử lại ở tick sau
+      if (!startCut(p.useIgn, p.cut_us, p.sparks, p.per, p.align, p.pmask, p.plen)) {
+        cutReason="flash_wait";
+        break;
       }
-      cut = constrain(cut, CUT_MS_MIN, CUT_MS_MAX);
-      
-      // Do cut (non-blocking)
-      CUT::pulse(useIgn? CutLine::IGN : CutLine::INJ, cut);
-      lastCut = cut;
-      lastCutTime = millis();
-      pushLog(rpm, cut, cfg.mode==Mode::AUTO, bf, cfg.cut_output, "shift");
-      st=State::RECOVER; 
-      tEntry=millis();
+      st=State::CUT; 
+      onCutStarted(cfg, rpm, p, false);
     } break;
 
     case State::RECOVER: {
       uint32_t elapsed = millis() - tEntry;
-      if (elapsed >= CFG::get().holdoff_ms) { 
+      if (elapsed >= cfg.holdoff_ms) { 
         st=State::IDLE; 
         cutReason="ok";
         holdoffRemainMs = 0;
+        s_sparkLeft = 0;
+        TRIG::take(); // cạnh đến trong holdoff bị bỏ
       } else {
-        holdoffRemainMs = CFG::get().holdoff_ms - elapsed;
+        holdoffRemainMs = cfg.holdoff_ms - elapsed;
         cutReason="holdoff";
       }
       break;
     }
+
+    default: break;
   }
+
+  // Launch: giữ tới khi nhả cần
+  if (launchHold && !(cfg.launch_enable && TRIG::rawLevel())) launchHold = false;
+  static bool s_launchArmed = false;
+  if (launchHold != s_launchArmed) { s_launchArmed = launchHold; LIMIT::armLaunch(launchHold); }
+
+  // Arm fast path cho cạnh kế tiếp: tắt cờ trước khi ghi kế hoạch, bật lại sau cùng
+  s_fastArmed = false;
+  if (st == State::IDLE && rpm >= cfg.rpm_min && s_fastSeq == s_fastSeen) {
+    s_fastPlan = planCut(cfg, rpm);
+    s_fastIgn = s_fastPlan.useIgn;
+    s_fastCutUs = s_fastPlan.cut_us;
+    s_fastSparks = s_fastPlan.sparks;
+    s_fastPer = s_fastPlan.per;
+    s_fastAlign = s_fastPlan.align;
+    s_fastPMask = s_fastPlan.pmask;
+    s_fastPLen = s_fastPlan.plen;
+    s_fastArmSeq = s_fastSeen;
+    s_fastArmed = true;
+  }
+}
+
+void CTRL::disarm(){ s_fastArmed = false; }
+void CTRL::setCutHook(void (*hook)(uint32_t)){ s_cutHook = hook; }
+
+CTRL::Latency CTRL::getTriggerLatency(){
+  Latency l{};
+  l.count = s_latCnt; l.fast = s_latFast; l.last_us = s_latLast; l.max_us = s_latMax;
+  l.avg_us = s_latCnt ? (uint32_t)(s_latSum / s_latCnt) : 0;
+  l.spark_released = s_sparkRel;
+  l.align_last_us = s_alignLast;
+  l.align_avg_us = s_latCnt ? (uint32_t)(s_alignSum / s_latCnt) : 0;
+  return l;
 }
@@ -6,6 +6,18 @@ enum class State { IDLE=0, ARMED, CUT, RECOVER };
 namespace CTRL {
   void begin();
   void tick(); // call in loop
+  void disarm(); // tắt fast path trigger (khi loop không chạy tick, vd. đang khóa)
+  // Gọi trong loop mỗi khi QS bắt đầu cắt, end_us = lúc cut dự kiến nhả (timeline CUT::nowUs)
+  void setCutHook(void (*hook)(uint32_t end_us));
+
+  // Độ trễ cạnh trigger → lệnh cắt (µs)
+  struct Latency {
+    uint32_t count; uint32_t fast; uint32_t last_us; uint32_t max_us; uint32_t avg_us;
+    uint32_t spark_released; // SPARK mode: số cut nhả bằng đếm cạnh (còn lại = nhả theo giới hạn ms)
+    uint32_t align_last_us;  // căn pha: lệnh cắt → bắt đầu cắt (ngay trước lần đánh lửa kế tiếp)
+    uint32_t align_avg_us;
+  };
+  Latency getTriggerLatency();
   
   // Debug functions
   uint16_t getCurrentRPM();
@@ -0,0 +1,65 @@
+#include "cut_map.h"
+#include "skip_fire.h"
+
+static uint8_t lut[CUTMAP::ENTRIES]; // cut_ms (<= CUT_MS_MAX nên vừa 1 byte)
+static uint8_t pat[CUTMAP::ENTRIES]; // chỉ số SKIP::PATTERNS
+
+static inline uint8_t clampMs(uint32_t ms){ return (uint8_t)(ms > 255 ? 255 : ms); }
+
+// số band tối đa = kích thước QSConfig::map (config_store còn giới hạn map_count chặt hơn)
+static constexpr uint8_t MAP_N = sizeof(QSConfig::map) / sizeof(QSConfig::map[0]);
+static_assert(MAP_N <= 8, "auto map grew: insertion sort below assumes a handful of bands");
+
+void CUTMAP::build(const QSConfig &c){
+  // manual, hoặc auto nhưng map rỗng → hằng số
+  memset(pat, 0, sizeof(pat));
+  if (c.mode == Mode::MANUAL || c.map_count == 0) {
+    memset(lut, clampMs(c.manual_kill_ms), sizeof(lut));
+    return;
+  }
+
+  // tâm các band, sắp theo rpm (tối đa MAP_N phần tử → insertion sort)
+  const uint8_t n = min<uint8_t>(c.map_count, MAP_N);
+  uint32_t ctr[MAP_N];
+  uint16_t ms[MAP_N];
+  for (uint8_t i = 0; i < n; i++) {
+    uint32_t cc = ((uint32_t)c.map[i].rpm_lo + c.map[i].rpm_hi) / 2;
+    uint16_t mm = c.map[i].cut_ms;
+    int8_t j = (int8_t)i - 1;
+    while (j >= 0 && ctr[j] > cc) { ctr[j + 1] = ctr[j]; ms[j + 1] = ms[j]; j--; }
+    ctr[j + 1] = cc; ms[j + 1] = mm;
+  }
+
+  uint8_t k = 0; // band có tâm <= rpm
+  for (uint16_t b = 0; b < ENTRIES; b++) {
+    const uint32_t rpm = ((uint32_t)b << SHIFT) + (1u << (SHIFT - 1)); // tâm ô
+    while (k + 1 < n && ctr[k + 1] <= rpm) k++;
+    if (rpm <= ctr[0])           lut[b] = clampMs(ms[0]);
+    else if (k + 1 >= n)         lut[b] = clampMs(ms[n - 1]);
+    else {
+      const int32_t d = (int32_t)ms[k + 1] - (int32_t)ms[k];
+      const uint32_t span = ctr[k + 1] - ctr[k];
+      lut[b] = clampMs((uint32_t)((int32_t)ms[k] + (d * (int32_t)(rpm - ctr[k]) + (int32_t)span / 2) / (int32_t)span));
+    }
+  }
+
+  // mẫu skip-fire chỉ dùng ở AUTO (SPARK đã đếm theo lần đánh lửa)
+  if (c.mode != Mode::AUTO) return;
+  for (uint8_t i = 0; i < n; i++) {
+    const uint8_t p = c.map[i].pattern < SKIP::COUNT ? c.map[i].pattern : SKIP::SOLID;
+    if (p == SKIP::SOLID) continue;
+    const uint16_t b0 = c.map[i].rpm_lo >> SHIFT;
+    const uint16_t b1 = min<uint16_t>(c.map[i].rpm_hi >> SHIFT, ENTRIES - 1);
+    for (uint16_t b = b0; b <= b1; b++) pat[b] = p;
+  }
+}
+
+uint8_t CUTMAP::pattern(uint16_t rpm){
+  const uint16_t i = rpm >> SHIFT;
+  return pat[i < ENTRIES ? i : ENTRIES - 1];
+}
+
+uint16_t CUTMAP::lookup(uint16_t rpm){
+  const uint16_t i = rpm >> SHIFT;
+  return lut[i < ENTRIES ? i : ENTRIES - 1];
+}
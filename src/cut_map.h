@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Bảng tra rpm → cut_ms dựng sẵn trong RAM (256 ô × 64 rpm), nội suy tuyến tính giữa
+// tâm các band của auto map. Chỉ dựng lại khi config đổi; tra cứu O(1).
+// Kèm bảng mẫu skip-fire: ô nằm trong [lo, hi] của band nào thì lấy mẫu band đó (ngoài: liền).
+namespace CUTMAP {
+  static constexpr uint8_t  SHIFT   = 6;              // 64 rpm / ô
+  static constexpr uint16_t ENTRIES = 256;            // 0 .. 16383 rpm, trên nữa dùng ô cuối
+
+  void build(const QSConfig &c);
+  uint16_t lookup(uint16_t rpm);
+  uint8_t  pattern(uint16_t rpm);
+}
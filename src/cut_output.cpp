@@ -1,46 +1,336 @@
 #include "cut_output.h"
+#include "cut_timer.h"
 #include "pins.h"
 
+// Bộ lập lịch cắt theo line: mỗi line có hàng đợi nhỏ các yêu cầu hẹn giờ [start, end) kèm
+// ưu tiên (LOCK > LIMITER > QS > BACKFIRE > TEST). Line bị cắt khi có ít nhất 1 yêu cầu hiệu lực.
+// Mọi thay đổi trạng thái đi qua evaluate(): nhả/bắt đầu yêu cầu tới hạn, ghi chân, rồi hẹn
+// timer one-shot (cut_timer.h) tới sự kiện gần nhất → độ dài xung không phụ thuộc loop().
+// Toàn bộ nằm trong IRAM và chạy trong CUTTMR::enter()/exit(): ISR trigger gọi trực tiếp được.
+// tick() chỉ là lưới an toàn khi timer lỗi.
+
+static constexpr uint32_t TICK_GRACE_US = 2000; // tick() chỉ xử lý khi timer trễ quá mức này
+
+enum : uint8_t { RQ_USED = 1, RQ_STARTED = 2, RQ_HOLD = 4 };
+
+struct CutReq {
+  uint32_t start_us;  // thời điểm bắt đầu theo lịch
+  uint32_t end_us;    // bỏ qua nếu RQ_HOLD
+  uint32_t act_us;    // thời điểm bắt đầu thực tế
+  uint8_t  prio;
+  uint8_t  flags;
+};
+
 // ---- state ----
-static uint8_t pIgn, pInj;
-static bool s_ign=false, s_inj=false;
-static bool s_pulsing=false;
-static uint32_t s_pulse_end=0;
-static CutLine s_pulse_line=CutLine::IGN;
+static uint8_t  s_pin[2];
+static bool     s_out[2] = {false, false};
+static CutReq   s_q[2][CUT::QUEUE_N];
+static uint32_t s_due = 0;          // sự kiện kế tiếp đã hẹn timer
+static bool     s_due_valid = false;
+static uint32_t s_last_start = 0;
+static uint32_t s_resv = 0;         // reserve(): flashLock() bị từ chối tới mốc này
+static bool     s_resv_valid = false;
+static bool     s_flash = false;    // PLOG đang ghi flash: mọi yêu cầu hẹn giờ bị từ chối
+
+// timeline đang phát trên mỗi line (bước kế tiếp = next)
+struct TlState { CUT::Timeline tl; uint32_t t0; uint8_t next; uint8_t prio; bool on; };
+static TlState  s_tl[2];
+
+// ---- thống kê ----
+static uint32_t s_cnt=0, s_last_req=0, s_last_act=0;
+static int32_t  s_err_min=0, s_err_max=0;
+static int64_t  s_err_sum=0;
+static uint32_t s_merged=0, s_preempted=0, s_rejected=0;
+
+// always_inline: gọi từ hàm IRAM, không được nằm ở flash
+#define CUT_INLINE __attribute__((always_inline)) static inline
+
+CUT_INLINE bool before(uint32_t a, uint32_t b){ return (int32_t)(a - b) < 0; } // wrap-safe
+
+CUT_INLINE void nextDue(bool& have, uint32_t& due, uint32_t t){
+  if (!have || before(t, due)) { due = t; have = true; }
+}
+
+// hold đã bắt đầu: hiệu lực tới khi huỷ, không so start_us nữa (sau 2^31 µs ≈ 35.8 phút
+// phép so có dấu đảo chiều → lock bị nhả nhầm / ưu tiên thấp lọt qua)
+CUT_INLINE bool heldOn(const CutReq& r){
+  return (r.flags & (RQ_HOLD | RQ_STARTED)) == (RQ_HOLD | RQ_STARTED);
+}
+
+CUT_INLINE bool overlaps(const CutReq& r, uint32_t s, uint32_t e, bool hold){
+  return (hold || heldOn(r) || before(r.start_us, e)) && ((r.flags & RQ_HOLD) || before(s, r.end_us));
+}
+
+static void IRAM_ATTR recordPulse(const CutReq& r, uint32_t now){
+  const uint32_t req = r.end_us - r.start_us;
+  const uint32_t act = now - r.act_us;
+  const int32_t err = (int32_t)(act - req);
+  if (s_cnt == 0 || err < s_err_min) s_err_min = err;
+  if (s_cnt == 0 || err > s_err_max) s_err_max = err;
+  s_err_sum += err;
+  s_last_req = req; s_last_act = act;
+  s_cnt++;
+}
+
+static bool IRAM_ATTR insert(uint8_t l, uint8_t prio, uint32_t s, uint32_t e, bool hold);
+
+static void IRAM_ATTR evaluate(uint32_t now){
+  bool have_due = false; uint32_t due = 0;
+
+  for (uint8_t l = 0; l < 2; l++) {
+    // nạp các bước timeline đã tới hạn trước khi quét (bước bắt đầu ngay trong lượt này)
+    TlState& p = s_tl[l];
+    while (p.on && p.next < p.tl.n && !before(now, p.t0 + p.tl.on_us[p.next])) {
+      insert(l, p.prio, p.t0 + p.tl.on_us[p.next], p.t0 + p.tl.off_us[p.next], false);
+      p.next++;
+    }
+    if (p.on) {
+      if (p.next < p.tl.n) nextDue(have_due, due, p.t0 + p.tl.on_us[p.next]);
+      else p.on = false;
+    }
+
+    bool cut = false;
+    for (uint8_t i = 0; i < CUT::QUEUE_N; i++) {
+      CutReq& r = s_q[l][i];
+      if (!(r.flags & RQ_USED)) continue;
+      const bool hold = r.flags & RQ_HOLD;
+      if (!hold && !before(now, r.end_us)) {
+        if (r.flags & RQ_STARTED) recordPulse(r, now);
+        r.flags = 0;
+        continue;
+      }
+      if (heldOn(r) || !before(now, r.start_us)) {
+        if (!(r.flags & RQ_STARTED)) { r.flags |= RQ_STARTED; r.act_us = now; s_last_start = now; }
+        cut = true;
+        if (!hold) nextDue(have_due, due, r.end_us);
+      } else {
+        nextDue(have_due, due, r.start_us);
+      }
+    }
+    if (cut != s_out[l]) { CUTTMR::writePin(s_pin[l], cut); s_out[l] = cut; }
+  }
+
+  s_due = due; s_due_valid = have_due;
+  if (have_due) CUTTMR::start(before(now, due) ? due - now : 0);
+  else CUTTMR::stop();
+}
+
+// Thêm yêu cầu theo quy tắc ưu tiên/gộp (xem cut_output.h). Gọi trong critical section.
+static bool IRAM_ATTR insert(uint8_t l, uint8_t prio, uint32_t s, uint32_t e, bool hold){
+  CutReq* q = s_q[l];
+
+  // 1) trùng yêu cầu ưu tiên cao hơn: phần kéo dài quá nó được giữ (dời start), nằm gọn → từ chối
+  for (uint8_t pass = 0; pass <= CUT::QUEUE_N; pass++) {
+    bool moved = false;
+    for (uint8_t i = 0; i < CUT::QUEUE_N; i++) {
+      const CutReq& r = q[i];
+      if (!(r.flags & RQ_USED) || r.prio <= prio || !overlaps(r, s, e, hold)) continue;
+      if (hold || (r.flags & RQ_HOLD) || !before(r.end_us, e)) { s_rejected++; return false; }
+      s = r.end_us; moved = true; s_preempted++;
+    }
+    if (!moved) break;
+  }
+
+  // 2) ưu tiên thấp hơn bị trùng → cắt ngắn tới s (nếu bắt đầu trước) hoặc huỷ
+  for (uint8_t i = 0; i < CUT::QUEUE_N; i++) {
+    CutReq& r = q[i];
+    if (!(r.flags & RQ_USED) || r.prio >= prio || !overlaps(r, s, e, hold)) continue;
+    if (before(r.start_us, s)) { r.end_us = s; r.flags &= ~RQ_HOLD; }
+    else r.flags = 0;
+    s_preempted++;
+  }
+
+  // 3) cùng ưu tiên, trùng hoặc liền kề → gộp vào slot đầu tiên, hút các slot còn lại
+  int8_t into = -1;
+  for (uint8_t i = 0; i < CUT::QUEUE_N; i++) {
+    CutReq& r = q[i];
+    if (!(r.flags & RQ_USED) || r.prio != prio) continue;
+    const bool touch = (hold || heldOn(r) || !before(e, r.start_us)) && ((r.flags & RQ_HOLD) || !before(r.end_us, s));
+    if (!touch) continue;
+    if (into < 0) {
+      into = i;
+      if (!(r.flags & RQ_STARTED) && before(s, r.start_us)) r.start_us = s;
+      if (hold) r.flags |= RQ_HOLD;
+      else if (!(r.flags & RQ_HOLD) && before(r.end_us, e)) r.end_us = e;
+      s_merged++;
+    } else {
+      CutReq& m = q[into];
+      if (!(m.flags & RQ_STARTED) && before(r.start_us, m.start_us)) m.start_us = r.start_us;
+      if (r.flags & RQ_HOLD) m.flags |= RQ_HOLD;
+      else if (!(m.flags & RQ_HOLD) && before(m.end_us, r.end_us)) m.end_us = r.end_us;
+      r.flags = 0;
+    }
+  }
+  if (into >= 0) return true;
+
+  // 4) slot trống, hết chỗ thì thay yêu cầu ưu tiên thấp nhất (thấp hơn yêu cầu mới)
+  int8_t slot = -1;
+  for (uint8_t i = 0; i < CUT::QUEUE_N; i++) if (!(q[i].flags & RQ_USED)) { slot = i; break; }
+  if (slot < 0) {
+    for (uint8_t i = 0; i < CUT::QUEUE_N; i++) {
+      if (q[i].prio < prio && (slot < 0 || q[i].prio < q[slot].prio)) slot = i;
+    }
+    if (slot < 0) { s_rejected++; return false; }
+    s_preempted++;
+  }
+  CutReq& n = q[slot];
+  n.start_us = s; n.end_us = e; n.act_us = 0; n.prio = prio;
+  n.flags = RQ_USED | (hold ? RQ_HOLD : 0);
+  return true;
+}
+
+static void onTimer(){
+  CUTTMR::enter();
+  evaluate(CUTTMR::nowUs());
+  CUTTMR::exit();
+}
 
 // ---- impl ----
 void CUT::begin(uint8_t pinIgn, uint8_t pinInj){
-  pIgn=pinIgn; pInj=pinInj;
-  pinMode(pIgn, OUTPUT); pinMode(pInj, OUTPUT);
-  digitalWrite(pIgn, LOW); digitalWrite(pInj, LOW);
-  s_ign = s_inj = s_pulsing = false;
+  s_pin[0]=pinIgn; s_pin[1]=pinInj;
+  pinMode(pinIgn, OUTPUT); pinMode(pinInj, OUTPUT);
+  CUTTMR::writePin(pinIgn, false); CUTTMR::writePin(pinInj, false);
+  s_out[0] = s_out[1] = false;
+  memset(s_q, 0, sizeof(s_q));
+  memset(s_tl, 0, sizeof(s_tl));
+  s_due_valid = false;
+  s_resv_valid = false;
+  __atomic_store_n(&s_flash, false, __ATOMIC_RELEASE);
+  CUTTMR::begin(onTimer);
+  resetStats();
+}
+
+bool IRAM_ATTR CUT::request(CutLine line, CutPrio prio, uint32_t dur_us, uint32_t delay_us){
+  return requestAt(line, prio, CUTTMR::nowUs() + delay_us, dur_us);
+}
+
+bool IRAM_ATTR CUT::requestAt(CutLine line, CutPrio prio, uint32_t start_us, uint32_t dur_us){
+  CUTTMR::enter();
+  if (s_flash) { s_rejected++; CUTTMR::exit(); return false; }
+  const bool ok = insert((uint8_t)line, (uint8_t)prio, start_us, start_us + dur_us, false);
+  evaluate(CUTTMR::nowUs());
+  CUTTMR::exit();
+  return ok;
+}
+
+void IRAM_ATTR CUT::cancel(CutLine line, CutPrio prio){
+  CUTTMR::enter();
+  for (uint8_t i = 0; i < QUEUE_N; i++) {
+    CutReq& r = s_q[(uint8_t)line][i];
+    if ((r.flags & RQ_USED) && r.prio == (uint8_t)prio) r.flags = 0;
+  }
+  evaluate(CUTTMR::nowUs());
+  CUTTMR::exit();
+}
+
+bool CUT::play(CutLine line, CutPrio prio, uint32_t t0_us, const Timeline &tl){
+  if (tl.n == 0 || tl.n > TIMELINE_MAX) return false;
+  for (uint8_t i = 0; i < tl.n; i++) {
+    if (tl.off_us[i] <= tl.on_us[i] || (i && tl.on_us[i] < tl.off_us[i - 1])) return false;
+  }
+  CUTTMR::enter();
+  if (s_flash) { s_rejected++; CUTTMR::exit(); return false; }
+  TlState& p = s_tl[(uint8_t)line];
+  p.tl = tl; p.t0 = t0_us; p.next = 0; p.prio = (uint8_t)prio; p.on = true;
+  evaluate(CUTTMR::nowUs());
+  CUTTMR::exit();
+  return true;
+}
+
+void CUT::stopTimeline(CutLine line){
+  TlState& p = s_tl[(uint8_t)line];
+  CUTTMR::enter();
+  const bool was = p.on || p.next;
+  p.on = false; p.next = 0;
+  CUTTMR::exit();
+  if (was) cancel(line, (CutPrio)p.prio);
 }
 
+bool CUT::playing(CutLine line){ return s_tl[(uint8_t)line].on; }
+
 void CUT::set(CutLine line, bool cutting){
-  const uint8_t p = (line==CutLine::IGN? pIgn : pInj);
-  digitalWrite(p, cutting? HIGH:LOW);
-  if (line==CutLine::IGN) s_ign = cutting; else s_inj = cutting;
+  if (!cutting) { cancel(line, CutPrio::LOCK); return; }
+  CUTTMR::enter();
+  // đã giữ cắt LOCK rồi (loop gọi set() mỗi vòng) → không gộp, không hẹn lại timer
+  for (uint8_t i = 0; i < QUEUE_N; i++) {
+    const CutReq& r = s_q[(uint8_t)line][i];
+    if ((r.flags & (RQ_USED | RQ_HOLD)) == (RQ_USED | RQ_HOLD) && r.prio == (uint8_t)CutPrio::LOCK) {
+      CUTTMR::exit();
+      return;
+    }
+  }
+  const uint32_t now = CUTTMR::nowUs();
+  insert((uint8_t)line, (uint8_t)CutPrio::LOCK, now, now, true);
+  evaluate(now);
+  CUTTMR::exit();
+}
+
+bool CUT::isActive(){ return s_out[0] || s_out[1]; }
+bool CUT::isActive(CutLine line){ return s_out[(uint8_t)line]; }
+// đọc từ task khác (PLOG) ngoài critical section: chỉ để quyết định có thử flashLock() không
+bool CUT::pending(){
+  if (__atomic_load_n(&s_due_valid, __ATOMIC_RELAXED)) return true;
+  return __atomic_load_n(&s_resv_valid, __ATOMIC_RELAXED) && before(CUTTMR::nowUs(), s_resv);
+}
+
+void IRAM_ATTR CUT::reserve(uint32_t until_us){
+  CUTTMR::enter();
+  if (!s_resv_valid || before(s_resv, until_us)) { s_resv = until_us; s_resv_valid = true; }
+  CUTTMR::exit();
 }
 
-bool CUT::isActive(){ return s_ign || s_inj; }
+// Kiểm tra và khoá trong cùng 1 critical section: ISR trigger / loop không thể bắt đầu xung
+// xen giữa lúc PLOG thấy "rảnh" và lúc PLOG bắt đầu ghi.
+bool CUT::flashLock(){
+  CUTTMR::enter();
+  const uint32_t now = CUTTMR::nowUs();
+  if (s_resv_valid && !before(now, s_resv)) s_resv_valid = false; // hết hạn: bỏ (tránh so sánh wrap sau 35 phút)
+  const bool ok = !s_flash && !s_due_valid && !s_resv_valid;
+  if (ok) __atomic_store_n(&s_flash, true, __ATOMIC_RELEASE);
+  CUTTMR::exit();
+  return ok;
+}
 
-// Pulse không chặn (non-blocking), gọi CUT::tick() trong loop
-void CUT::pulse(CutLine line, uint16_t ms){
-  CUT::set(line, true);
-  s_pulsing = true; s_pulse_line = line;
-  s_pulse_end = millis() + (uint32_t)ms;
+void CUT::flashUnlock(){
+  CUTTMR::enter();
+  __atomic_store_n(&s_flash, false, __ATOMIC_RELEASE);
+  CUTTMR::exit();
 }
 
+bool IRAM_ATTR CUT::flashLocked(){ return __atomic_load_n(&s_flash, __ATOMIC_ACQUIRE); }
+
+void CUT::pulse(CutLine line, uint16_t ms, CutPrio prio){ pulse_us(line, (uint32_t)ms * 1000UL, prio); }
+
+// Pulse không chặn (non-blocking): timer one-shot nhả đúng hẹn
+bool IRAM_ATTR CUT::pulse_us(CutLine line, uint32_t us, CutPrio prio){ return request(line, prio, us, 0); }
+
 void CUT::tick(){
-  if (s_pulsing && (millis() >= s_pulse_end)){
-    CUT::set(s_pulse_line, false);
-    s_pulsing = false;
-  }
+  if (!s_due_valid) return;
+  const uint32_t now = CUTTMR::nowUs();
+  if ((int32_t)(now - s_due) < (int32_t)TICK_GRACE_US) return;
+  CUTTMR::enter();
+  evaluate(now);
+  CUTTMR::exit();
+}
+
+uint32_t CUT::startUs(){ return s_last_start; }
+uint32_t IRAM_ATTR CUT::nowUs(){ return CUTTMR::nowUs(); }
+
+CUT::PulseStats CUT::stats(){
+  PulseStats s{};
+  s.count = s_cnt; s.last_req_us = s_last_req; s.last_act_us = s_last_act;
+  s.err_min_us = s_err_min; s.err_max_us = s_err_max;
+  s.err_avg_us = s_cnt ? (int32_t)(s_err_sum / (int64_t)s_cnt) : 0;
+  s.merged = s_merged; s.preempted = s_preempted; s.rejected = s_rejected;
+  return s;
+}
+
+void CUT::resetStats(){
+  s_cnt = 0; s_last_req = s_last_act = 0; s_err_min = s_err_max = 0; s_err_sum = 0;
+  s_merged = s_preempted = s_rejected = 0;
 }
 
-// Test blocking (chỉ dùng cho /api/testcut)
+// Test output (/api/testcut): ưu tiên thấp nhất, không chặn task web
 void CUT_testPulse(bool useIgn, uint16_t ms){
-  CUT::set(useIgn? CutLine::IGN : CutLine::INJ, true);
-  delay(ms);
-  CUT::set(useIgn? CutLine::IGN : CutLine::INJ, false);
+  CUT::pulse(useIgn? CutLine::IGN : CutLine::INJ, ms, CutPrio::TEST);
 }
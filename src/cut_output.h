@@ -3,11 +3,68 @@
 
 enum class CutLine { IGN=0, INJ=1 };
 
+// Mức ưu tiên khi nhiều nguồn cùng muốn cắt 1 line (cao thắng)
+enum class CutPrio : uint8_t { TEST=0, BACKFIRE=1, QS=2, LIMITER=3, LOCK=4 };
+
 namespace CUT {
+  static constexpr uint8_t QUEUE_N = 4; // số yêu cầu hẹn giờ tối đa mỗi line
+
+  // Sai số độ dài xung cắt (thực tế - yêu cầu), đo tại callback nhả
+  struct PulseStats {
+    uint32_t count;        // số xung đã nhả
+    uint32_t last_req_us;  // độ dài yêu cầu của xung cuối
+    uint32_t last_act_us;  // độ dài thực tế của xung cuối
+    int32_t  err_min_us;
+    int32_t  err_max_us;
+    int32_t  err_avg_us;   // trung bình từ lúc begin()/resetStats()
+    uint32_t merged;       // yêu cầu cùng ưu tiên gộp vào xung đang có
+    uint32_t preempted;    // yêu cầu ưu tiên thấp bị cắt ngắn/huỷ bởi ưu tiên cao hơn
+    uint32_t rejected;     // yêu cầu bị từ chối (trùng ưu tiên cao hơn / hàng đợi đầy)
+  };
+
   void begin(uint8_t pinIgn, uint8_t pinInj);
-  void set(CutLine line, bool cutting); // true = open (cut), false = closed (run)
+
+  // Lập lịch cắt [now + delay_us, now + delay_us + dur_us) trên line. Quy tắc:
+  //  - trùng/chạm yêu cầu CÙNG ưu tiên → gộp (kéo dài), không ghi đè;
+  //  - trùng yêu cầu ưu tiên CAO hơn → phần sau khi nó kết thúc vẫn được giữ (line cắt liền),
+  //    nằm gọn bên trong → từ chối;
+  //  - yêu cầu ưu tiên THẤP hơn bị trùng → cắt ngắn tới lúc yêu cầu mới bắt đầu (hoặc huỷ).
+  // Line bị cắt khi có ít nhất 1 yêu cầu đang hiệu lực. Gọi được trong ISR.
+  bool request(CutLine line, CutPrio prio, uint32_t dur_us, uint32_t delay_us = 0);
+  bool requestAt(CutLine line, CutPrio prio, uint32_t start_us, uint32_t dur_us); // start tuyệt đối (nowUs())
+  void cancel(CutLine line, CutPrio prio);  // huỷ mọi yêu cầu của prio trên line
+
+  // Chuỗi cắt biên dịch sẵn: bước i cắt [t0 + on_us[i], t0 + off_us[i]), offset tăng dần.
+  // Timer của scheduler nạp từng bước vào hàng đợi đúng lúc bắt đầu (qua cùng quy tắc ưu
+  // tiên như request()) → nhịp on/off không phụ thuộc loop(). Mỗi line chạy 1 timeline.
+  static constexpr uint8_t TIMELINE_MAX = 8;
+  struct Timeline { uint8_t n; uint32_t on_us[TIMELINE_MAX]; uint32_t off_us[TIMELINE_MAX]; };
+  bool play(CutLine line, CutPrio prio, uint32_t t0_us, const Timeline &tl); // thay timeline cũ
+  void stopTimeline(CutLine line);         // huỷ các bước còn lại và bước đang chạy
+  bool playing(CutLine line);
+
+  void set(CutLine line, bool cutting); // giữ cắt vô thời hạn ở mức LOCK (false = nhả)
   bool isActive();                         // đang có line nào bị cắt?
-void pulse(CutLine line, uint16_t ms);   // cắt không chặn trong ms
-void tick();                             // gọi mỗi vòng loop để nhả đúng hẹn
+  bool isActive(CutLine line);
+  bool pending();                          // có sự kiện đang hẹn timer (xung đang chạy chờ nhả / sắp bắt đầu /
+                                           // bước timeline kế tiếp) hoặc cửa sổ reserve() chưa hết?
+                                           // Giữ cắt LOCK không tính.
 
+  // ---- Cổng ghi flash (PLOG) ----
+  // Ghi/xoá flash tắt cache: trên ESP32-C3 task esp_timer nhả cắt đứng chờ tới khi ghi xong.
+  // flashLock() chỉ thành công khi !pending() (kiểm tra + khoá trong 1 critical section); trong
+  // lúc khoá, request()/requestAt()/play() bị từ chối (đếm vào rejected) → không có xung hẹn giờ
+  // nào để bị kéo dài. Giữ cắt LOCK (set()) và cancel() vẫn chạy. Bên gọi tự thử lại sau
+  // (QS chờ ở ARMED, backfire ở tick kế tiếp); rev limiter bỏ qua các lần đánh lửa trong lúc ghi.
+  void reserve(uint32_t until_us);         // giữ cửa sổ (vd. cả xung QS/skip-fire): flashLock() từ chối tới until_us. ISR-safe
+  bool flashLock();
+  void flashUnlock();
+  bool flashLocked();                      // ISR-safe
+  void pulse(CutLine line, uint16_t ms, CutPrio prio = CutPrio::QS);      // cắt không chặn trong ms
+  bool pulse_us(CutLine line, uint32_t us, CutPrio prio = CutPrio::QS);  // = request(), delay 0
+  void tick();                             // dự phòng: xử lý nếu timer không chạy được
+  uint32_t startUs();                      // thời điểm (µs, timeline esp_timer) bắt đầu xung gần nhất
+  uint32_t nowUs();                        // timeline của scheduler (= timestamp cạnh RPM/trigger)
+  PulseStats stats();
+  void resetStats();
 }
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+
+// ===== Timer one-shot cho nhả cắt =====
+// Callback chạy ngay khi hết hạn, không phụ thuộc vòng loop() (web/DNS/lock có chậm cũng không sao).
+// start/stop/nowUs/writePin/enter/exit nằm trong IRAM: CUT::pulse_us() gọi được từ ISR trigger.
+//  - cut_timer_esp.cpp (ARDUINO): esp_timer one-shot, callback chạy trong task esp_timer
+//                                  (ưu tiên cao hơn loop/web → trễ cỡ chục µs).
+//  - cut_timer_sim.cpp (host)   : đồng hồ mô phỏng, callback chạy trong simAdvance().
+namespace CUTTMR {
+  using Callback = void (*)();
+
+  void     begin(Callback cb);
+  bool     start(uint32_t us);  // hẹn callback sau us (huỷ hẹn cũ nếu có), false nếu lỗi
+  void     stop();
+  uint32_t nowUs();             // cùng timeline với thời điểm callback
+  void     writePin(uint8_t pin, bool level); // ghi GPIO trực tiếp, gọi được trong ISR
+  void     enter();             // critical section dùng chung task/ISR (fast path trigger)
+  void     exit();
+
+  // Chỉ có ở backend sim (host)
+  void     simAdvance(uint32_t now_us); // chạy callback cho mọi hẹn <= now_us
+  bool     simPin(uint8_t pin);         // mức cuối cùng writePin() ghi lên chân
+}
@@ -0,0 +1,38 @@
+#ifdef ARDUINO
+#include "cut_timer.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <hal/gpio_ll.h>
+
+static esp_timer_handle_t s_timer = nullptr;
+static CUTTMR::Callback   s_cb = nullptr;
+static portMUX_TYPE       s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void onTimer(void*){ if (s_cb) s_cb(); }
+
+void CUTTMR::begin(Callback cb){
+  s_cb = cb;
+  if (s_timer) return;
+  esp_timer_create_args_t a = {};
+  a.callback = onTimer;
+  a.dispatch_method = ESP_TIMER_TASK;
+  a.name = "cut";
+  esp_err_t e = esp_timer_create(&a, &s_timer);
+  if (e != ESP_OK) { s_timer = nullptr; Serial.printf("[CUT] esp_timer_create failed: %d\n", (int)e); }
+}
+
+// esp_timer_start_once/stop nằm trong IRAM và an toàn khi gọi từ ISR
+bool IRAM_ATTR CUTTMR::start(uint32_t us){
+  if (!s_timer) return false;
+  esp_timer_stop(s_timer); // ESP_ERR_INVALID_STATE nếu chưa chạy: bỏ qua
+  return esp_timer_start_once(s_timer, us) == ESP_OK;
+}
+
+void IRAM_ATTR CUTTMR::stop(){ if (s_timer) esp_timer_stop(s_timer); }
+uint32_t IRAM_ATTR CUTTMR::nowUs(){ return (uint32_t)esp_timer_get_time(); }
+void IRAM_ATTR CUTTMR::writePin(uint8_t pin, bool level){ gpio_ll_set_level(&GPIO, (gpio_num_t)pin, level ? 1 : 0); }
+void IRAM_ATTR CUTTMR::enter(){ portENTER_CRITICAL_SAFE(&s_mux); }
+void IRAM_ATTR CUTTMR::exit(){ portEXIT_CRITICAL_SAFE(&s_mux); }
+
+void CUTTMR::simAdvance(uint32_t){}
+#endif
@@ -0,0 +1,32 @@
+#ifndef ARDUINO
+#include "cut_timer.h"
+
+// Backend host: timer mô phỏng, thời gian do simAdvance() điều khiển,
+// để kiểm tra độ dài xung cắt và thống kê sai số trên Linux. Mức chân lưu trong mảng
+// (không qua digitalWrite) để test đọc lại bằng simPin().
+
+static CUTTMR::Callback s_cb = nullptr;
+static bool     s_armed = false;
+static uint32_t s_due = 0;
+static uint32_t s_now = 0;
+static bool     s_pins[64];
+
+void CUTTMR::begin(Callback cb){ s_cb = cb; s_armed = false; }
+bool CUTTMR::start(uint32_t us){ s_due = s_now + us; s_armed = true; return true; }
+void CUTTMR::stop(){ s_armed = false; }
+uint32_t CUTTMR::nowUs(){ return s_now; }
+void CUTTMR::writePin(uint8_t pin, bool level){ if (pin < 64) s_pins[pin] = level; }
+void CUTTMR::enter(){}
+void CUTTMR::exit(){}
+
+void CUTTMR::simAdvance(uint32_t now_us){
+  // mọi hẹn tới hạn trong bước này, mỗi callback chạy đúng thời điểm hẹn của nó
+  while (s_armed && (int32_t)(now_us - s_due) >= 0) {
+    s_now = s_due; s_armed = false;
+    if (s_cb) s_cb();
+  }
+  s_now = now_us;
+}
+
+bool CUTTMR::simPin(uint8_t pin){ return pin < 64 && s_pins[pin]; }
+#endif
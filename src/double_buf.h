@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+// Công bố giá trị nhiều word từ 1 writer cho nhiều reader (task khác / ISR) không cần khóa.
+// Writer ghi vào slot rảnh rồi đổi version; reader copy slot hiện tại rồi kiểm tra version
+// không đổi. Reader chen ngang writer đang ghi dở vẫn đọc được slot cũ ổn định (không phải
+// chờ writer chạy tiếp), writer không bao giờ phải chờ reader.
+template <typename T>
+class DoubleBuf {
+public:
+  void publish(const T &v) {
+    const uint32_t n = _ver + 1;
+    _b[n & 1] = v;
+    __atomic_store_n(&_ver, n, __ATOMIC_RELEASE);
+  }
+
+  T read() const {
+    for (;;) {
+      const uint32_t v1 = __atomic_load_n(&_ver, __ATOMIC_ACQUIRE);
+      T out = _b[v1 & 1];
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&_ver, __ATOMIC_RELAXED) == v1) return out;
+    }
+  }
+
+  uint32_t version() const { return __atomic_load_n(&_ver, __ATOMIC_ACQUIRE); }
+
+private:
+  T _b[2] = {};
+  uint32_t _ver = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Ring SPSC chứa timestamp (µs) của cạnh xung RPM.
+// Producer = ISR/backend capture (push), consumer = RPM::tick() (drain theo lô).
+// Không cần critical section: head chỉ do producer ghi, tail chỉ do consumer ghi.
+// head đồng thời là số thứ tự (sequence) của cạnh: tăng đơn điệu, không reset khi chạy.
+// Ngoài consumer chính, task bất kỳ có thể lấy snapshot bằng latest() (chỉ đọc).
+template <uint32_t N>
+class EdgeRing {
+  static_assert((N & (N - 1)) == 0, "EdgeRing size must be a power of 2");
+public:
+  // always_inline: được gọi từ ISR IRAM, không được nằm ở flash
+  __attribute__((always_inline)) inline void push(uint32_t t_us) {
+    const uint32_t h = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+    _buf[h & (N - 1)] = t_us;
+    __atomic_store_n(&_head, h + 1, __ATOMIC_RELEASE);
+  }
+
+  // Lấy tối đa max cạnh, cũ trước. Cạnh bị ISR ghi đè (consumer chậm) được đếm vào overruns().
+  size_t drain(uint32_t *out, size_t max) {
+    uint32_t h = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    uint32_t t = _tail;
+    if (h - t > N) { _overruns += (h - t - N); t = h - N; }
+    const uint32_t t0 = t;
+    size_t n = 0;
+    while (t != h && n < max) out[n++] = _buf[t++ & (N - 1)];
+
+    // ISR có thể đã ghi vòng qua vùng vừa copy → bỏ các phần tử đầu không còn hợp lệ
+    // (+1: ô tại head có thể đang được ghi dở)
+    const uint32_t h2 = __atomic_load_n(&_head, __ATOMIC_ACQUIRE) + 1;
+    if (h2 - t0 > N) {
+      uint32_t lost = (h2 - N) - t0;
+      if (lost > n) lost = n;
+      for (size_t i = lost; i < n; i++) out[i - lost] = out[i];
+      n -= lost; _overruns += lost;
+    }
+    _tail = t;
+    return n;
+  }
+
+  // Snapshot n cạnh mới nhất (mới trước), không khóa, gọi được từ nhiều task:
+  // đọc head → copy → đọc lại head, phần tử có thể đã bị ISR ghi đè thì bỏ.
+  // seq_out = head lúc snapshot (số cạnh đã bắt). Trả về số phần tử hợp lệ.
+  size_t latest(uint32_t *out, size_t n, uint32_t *seq_out = nullptr) const {
+    const uint32_t h = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    const uint32_t avail = (h < N - 1) ? h : N - 1; // ô tại head có thể đang được ghi
+    if (n > avail) n = avail;
+    for (size_t i = 0; i < n; i++) out[i] = _buf[(h - 1 - i) & (N - 1)];
+
+    const uint32_t lap = __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - h;
+    const uint32_t valid = (lap >= N - 1) ? 0 : (N - 1 - lap);
+    if (n > valid) n = valid;
+    if (seq_out) *seq_out = h;
+    return n;
+  }
+
+  uint32_t seq() const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE); }
+
+  // Chỉ gọi khi producer chưa chạy (begin/replayLoad)
+  void clear() { _head = _tail = _overruns = 0; }
+  void reset() { _tail = __atomic_load_n(&_head, __ATOMIC_ACQUIRE); }
+  uint32_t overruns() const { return _overruns; }
+
+private:
+  uint32_t _buf[N];
+  uint32_t _head = 0;      // producer
+  uint32_t _tail = 0;      // consumer
+  uint32_t _overruns = 0;  // consumer
+};
+
+// Cửa sổ blanking chạy trong ISR: bỏ cạnh đến quá sớm sau cạnh được nhận trước đó
+// (rung coil / gai thứ cấp). Độ rộng cửa sổ do consumer đặt theo chu kỳ dự báo.
+class EdgeBlanker {
+public:
+  __attribute__((always_inline)) inline bool accept(uint32_t now) {
+    const uint32_t w = __atomic_load_n(&_window_us, __ATOMIC_RELAXED);
+    if (_have && (now - _last) < w) { _rejected++; return false; }
+    _last = now; _have = true;
+    return true;
+  }
+  void setWindow(uint32_t us) { __atomic_store_n(&_window_us, us, __ATOMIC_RELAXED); }
+  uint32_t rejected() const { return __atomic_load_n(&_rejected, __ATOMIC_RELAXED); }
+  void clear() { _have = false; _window_us = 0; _rejected = 0; }
+
+private:
+  uint32_t _window_us = 0;
+  uint32_t _last = 0;
+  bool     _have = false;
+  uint32_t _rejected = 0;  // ghi trong ISR
+};
+
+// Đo độ rộng xung (cạnh mở → cạnh đóng đầu tiên) trong ISR, công bố bằng 1 word nguyên tử:
+// (bộ đếm xung << 16) | on-time µs. Cạnh đóng lặp lại (rung khi kim đóng) bị bỏ.
+class PulseWidth {
+public:
+  __attribute__((always_inline)) inline void open(uint32_t now) { _open_us = now; _open = true; }
+  __attribute__((always_inline)) inline void close(uint32_t now) {
+    if (!_open) return;
+    _open = false;
+    uint32_t w = now - _open_us; if (w > 0xFFFF) w = 0xFFFF;
+    const uint32_t n = (__atomic_load_n(&_word, __ATOMIC_RELAXED) >> 16) + 1;
+    __atomic_store_n(&_word, (n << 16) | w, __ATOMIC_RELEASE);
+  }
+  uint32_t word() const { return __atomic_load_n(&_word, __ATOMIC_ACQUIRE); }
+  void clear() { _open = false; _word = 0; }
+
+private:
+  uint32_t _open_us = 0;
+  bool     _open = false;
+  uint32_t _word = 0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Allocator vùng nhớ cố định cho JsonDocument của 1 request web (không dùng heap).
+// Cấp phát kiểu bump; chỉ khối cấp sau cùng mới được nới/thu/trả tại chỗ — đúng kiểu
+// ArduinoJson dùng (chuỗi đang dựng, pool slot vừa cấp, shrinkToFit lúc cuối).
+// Khối cũ hơn bị realloc thì cấp khối mới + copy, phần cũ bỏ phí tới reset().
+// Hết N byte → trả nullptr, ArduinoJson báo NoMemory; không bao giờ vượt N.
+// Không thread-safe: một chủ tại một thời điểm (task async_tcp).
+template <size_t N>
+class JsonPool : public ArduinoJson::Allocator {
+  static_assert(N % 8 == 0 && N < 65536, "JsonPool size");
+public:
+  void* allocate(size_t n) override {
+    const size_t sz = align(n);
+    if (_top + HDR + sz > N) { _fails++; return nullptr; }
+    Hdr* h = hdr(_top);
+    h->size = (uint16_t)sz; h->prev = (uint16_t)_last;
+    _last = _top;
+    _top += HDR + sz;
+    if (_top > _peak) _peak = _top;
+    return _buf + _last + HDR;
+  }
+
+  void deallocate(void* p) override {
+    if (p && off(p) == _last) { _top = _last; _last = hdr(_last)->prev; }
+  }
+
+  void* reallocate(void* p, size_t n) override {
+    if (!p) return allocate(n);
+    const size_t o = off(p), sz = align(n);
+    if (o == _last) { // khối cuối: đổi kích thước tại chỗ
+      if (o + HDR + sz > N) { _fails++; return nullptr; }
+      hdr(o)->size = (uint16_t)sz;
+      _top = o + HDR + sz;
+      if (_top > _peak) _peak = _top;
+      return p;
+    }
+    const size_t old = hdr(o)->size;
+    void* q = allocate(n);
+    if (q) memcpy(q, p, old < sz ? old : sz);
+    return q;
+  }
+
+  void     reset()          { _top = 0; _last = NONE; }
+  size_t   used() const     { return _top; }
+  size_t   peak() const     { return _peak; }   // đỉnh từ lần clearPeak() trước
+  void     clearPeak()      { _peak = _top; }
+  uint32_t fails() const    { return _fails; }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  struct Hdr { uint16_t size; uint16_t prev; uint32_t pad; };
+  static constexpr size_t HDR  = sizeof(Hdr);   // 8: giữ căn 8 byte cho double/int64
+  static constexpr size_t NONE = 0xFFFF;
+  static size_t align(size_t n) { return (n + 7) & ~(size_t)7; }
+  Hdr* hdr(size_t o) { return reinterpret_cast<Hdr*>(_buf + o); }
+  size_t off(void* p) const { return (size_t)((uint8_t*)p - _buf) - HDR; }
+
+  alignas(8) uint8_t _buf[N];
+  size_t   _top = 0, _last = NONE, _peak = 0;
+  uint32_t _fails = 0;
+};
@@ -40,7 +40,7 @@ namespace LOCK {
     retries = 0;
   }
 
-  bool isLocked() { return locked; }
+  bool IRAM_ATTR isLocked() { return locked; } // IRAM: fast path trigger đọc trong ISR
   bool justUnlocked() { 
     if (unlocked_pulse) {
       unlocked_pulse = false;
@@ -148,7 +148,7 @@ namespace LOCK {
   }
 
   void tick() {
-    auto c = cfg();
+    const QSConfig& c = CFG::snapshot(); // chạy trong loop: dùng bản đã ghim, không copy
     
     // EARLY RETURN: nếu lock không được bật, KHÔNG can thiệp gì
     if (!c.lock_enabled) { 
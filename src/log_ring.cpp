@@ -1,33 +1,158 @@
 #include "log_ring.h"
-#include <ArduinoJson.h>
 
-// Dùng uint16_t để tránh xung đột với size_t khi dùng min/so sánh
-static constexpr uint16_t RING_SZ = 64;
-static LogItem ring[RING_SZ];
-static volatile uint16_t head = 0; // next write index
+static_assert((LOGR::CAPACITY & (LOGR::CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
 
-void LOGR::begin(){ head = 0; }
+// Seqlock 1 writer (loop): push() đưa wseq lên lẻ, ghi ring/last_ms, rồi về chẵn; reader (web)
+// copy rồi so lại wseq. Fence release/acquire như CFG để compiler/CPU không đẩy lệnh ghi
+// bản ghi ra ngoài cặp cập nhật wseq.
+static LogRec ring[LOGR::CAPACITY];
+static uint32_t head = 0;       // next write index (đếm tăng, không modulo)
+static uint32_t last_ms = 0;    // thời điểm (đã lượng tử) của bản ghi mới nhất
+static uint32_t wseq = 0;       // chẵn = ổn định, lẻ = push đang ghi (web đọc lại)
+static uint32_t floor_seq = 0;  // clear(): bản ghi trước mốc này bị ẩn
+
+// Toàn bộ RAM của log (không có bản copy phía reader): 256 × 6 byte = 1536 byte, bằng
+// 64 × LogItem (24 byte) trước đây, cộng 4 bộ đếm.
+static_assert(sizeof(ring) + sizeof(head) + sizeof(last_ms) + sizeof(wseq) + sizeof(floor_seq)
+              <= 64 * 24 + 4 * sizeof(uint32_t), "log storage grew beyond the old RAM budget");
+
+static inline void writeBegin(){
+  __atomic_store_n(&wseq, __atomic_load_n(&wseq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+static inline void writeEnd(){ __atomic_store_n(&wseq, __atomic_load_n(&wseq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE); }
+
+static const char* const WHY_STR[8] = { "shift", "bf", "limit", "lock", "test", "?", "?", "other" };
+
+// Delta → (giá trị 16 bit, thang); trả về delta thực sự được ghi để mốc không trôi
+static inline uint32_t packDt(uint32_t dt, uint16_t &v, uint8_t &scale){
+  scale = 0;
+  while (dt > 0xFFFFUL << (4 * scale) && scale < 3) scale++;
+  uint32_t q = dt >> (4 * scale);
+  if (q > 0xFFFF) q = 0xFFFF;
+  v = (uint16_t)q;
+  return q << (4 * scale);
+}
+
+static inline uint32_t unpackDt(const LogRec &r){ return (uint32_t)r.dt << (4 * (r.flags >> 6)); }
+
+void LOGR::begin(){
+  writeBegin();
+  __atomic_store_n(&head, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&floor_seq, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&last_ms, 0, __ATOMIC_RELAXED);
+  writeEnd();
+}
 
 void LOGR::push(const LogItem &it){
-  // Snapshot biến volatile để tính toán nhất quán và tránh mismatch kiểu
-  uint16_t h = head;
-  ring[h % RING_SZ] = it;
-  head = h + 1;
-}
-
-size_t LOGR::readAllToJson(String &out){
-  StaticJsonDocument<4096> d; JsonArray a = d.to<JsonArray>();
-  // Snapshot head một lần
-  uint16_t h = head;
-  // Thay min<> bằng toán tử 3 ngôi để tránh lỗi chọn overload
-  uint16_t cnt = (h < RING_SZ) ? h : RING_SZ;
-  for (uint16_t i = 0; i < cnt; i++){
-    const LogItem &it = ring[(uint16_t)((h - cnt + i) % RING_SZ)];
-    JsonObject o = a.createNestedObject();
-    o["t"]=it.ts_ms; o["rpm"]=it.rpm; o["cut"]=it.cut_ms; o["auto"]=it.auto_mode; o["bf"]=it.backfire; o["out"]=it.out; o["why"]=it.reason;
+  const uint32_t h = head;       // chỉ loop ghi head/last_ms: đọc lại không cần atomic
+  uint16_t v; uint8_t scale;
+  const uint32_t prev = last_ms;
+  const uint32_t dt = h ? packDt(it.ts_ms - prev, v, scale) : (v = 0, scale = 0, 0);
+
+  LogRec r;
+  r.dt = v;
+  r.rpm = it.rpm;
+  r.cut_ms = it.cut_ms > 255 ? 255 : (uint8_t)it.cut_ms;
+  r.flags = (uint8_t)((it.out == LogOut::INJ ? 0x01 : 0) | (it.auto_mode ? 0x02 : 0) | (it.backfire ? 0x04 : 0) |
+                      (((uint8_t)it.why & 0x07) << 3) | (scale << 6));
+
+  writeBegin();
+  ring[h & (CAPACITY - 1)] = r;
+  __atomic_store_n(&last_ms, h ? prev + dt : it.ts_ms, __ATOMIC_RELAXED);
+  __atomic_store_n(&head, h + 1, __ATOMIC_RELAXED);
+  writeEnd();
+}
+
+uint32_t LOGR::seq(){ return __atomic_load_n(&head, __ATOMIC_ACQUIRE); }
+
+// Không có bản copy toàn ring: mốc/vị trí đọc được chốt 1 lần, bản ghi được copy từng lô nhỏ
+// trên stack và kiểm tra lại wseq theo từng lô.
+static constexpr uint8_t BATCH = 16;
+
+// Chốt vùng [from, head) (tối đa max) và mốc thời gian của bản đầu tiên dưới seqlock. from được
+// kẹp vào vùng còn trong ring; số bản ghi bị bỏ qua do kẹp trả về qua dropped.
+// Trả về -1 nếu push ghi chen cả 4 lần thử.
+static int32_t locate(uint32_t from, uint16_t max, uint32_t &first, uint32_t &t_first, uint32_t &dropped){
+  for (uint8_t tries = 0; tries < 4; tries++) {
+    const uint32_t s0 = __atomic_load_n(&wseq, __ATOMIC_ACQUIRE);
+    if (s0 & 1) continue;
+    const uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    const uint32_t fl = __atomic_load_n(&floor_seq, __ATOMIC_RELAXED);
+    uint32_t lo = fl, f = from, drop = 0;
+    if (h - lo > LOGR::CAPACITY) lo = h - LOGR::CAPACITY;
+    if ((int32_t)(f - lo) < 0) { drop = lo - ((int32_t)(f - fl) < 0 ? fl : f); f = lo; }
+    if ((int32_t)(f - h) > 0) f = h;  // client đi trước (sau reboot) → chỉ nhận bản mới
+    // mốc của bản đầu tiên = mốc mới nhất - tổng delta phía sau nó
+    uint32_t t = __atomic_load_n(&last_ms, __ATOMIC_RELAXED);
+    for (uint32_t i = h - 1; (int32_t)(i - f) > 0; i--) t -= unpackDt(ring[i & (LOGR::CAPACITY - 1)]);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&wseq, __ATOMIC_RELAXED) != s0) continue;
+    const uint32_t cnt = h - f;
+    first = f; t_first = t; dropped = drop;
+    return cnt > max ? max : (int32_t)cnt;
   }
-  serializeJson(d, out);
+  return -1;
+}
+
+// Copy nhất quán lô [idx, idx + n); false nếu push ghi chen cả 4 lần thử hoặc lô đã bị ghi đè
+static bool copyBatch(uint32_t idx, uint8_t n, LogRec *dst){
+  for (uint8_t tries = 0; tries < 4; tries++) {
+    const uint32_t s0 = __atomic_load_n(&wseq, __ATOMIC_ACQUIRE);
+    if (s0 & 1) continue;
+    if (__atomic_load_n(&head, __ATOMIC_RELAXED) - idx > LOGR::CAPACITY) return false;
+    for (uint8_t i = 0; i < n; i++) dst[i] = ring[(idx + i) & (LOGR::CAPACITY - 1)];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&wseq, __ATOMIC_RELAXED) == s0) return true;
+  }
+  return false;
+}
+
+// Ghi tối đa cnt bản ghi từ first; dừng ở lô đầu tiên không chụp được (không bao giờ ghi bản
+// ghi rách). Trả về số bản ghi đã ghi.
+static uint16_t writeItems(Print &out, uint16_t cnt, uint32_t first, uint32_t t, bool with_seq){
+  char buf[128];
+  LogRec chunk[BATCH];
+  uint16_t done = 0;
+  while (done < cnt) {
+    const uint8_t n = (cnt - done) < BATCH ? (uint8_t)(cnt - done) : BATCH;
+    if (!copyBatch(first + done, n, chunk)) break;
+    for (uint8_t k = 0; k < n; k++, done++) {
+      const LogRec &r = chunk[k];
+      if (done) t += unpackDt(r);
+      int len = snprintf(buf, sizeof(buf), "%s{\"t\":%lu,\"rpm\":%u,\"cut\":%u,\"auto\":%s,\"bf\":%s,\"out\":\"%s\",\"why\":\"%s\"",
+                         done ? "," : "", (unsigned long)t, (unsigned)r.rpm, (unsigned)r.cut_ms,
+                         (r.flags & 0x02) ? "true" : "false", (r.flags & 0x04) ? "true" : "false",
+                         (r.flags & 0x01) ? "INJ" : "IGN", WHY_STR[(r.flags >> 3) & 0x07]);
+      if (with_seq) len += snprintf(buf + len, sizeof(buf) - len, ",\"s\":%lu", (unsigned long)(first + done));
+      buf[len++] = '}';
+      out.write((const uint8_t*)buf, len);
+    }
+  }
+  return done;
+}
+
+size_t LOGR::writeAll(Print &out){
+  uint32_t first = 0, t = 0, dropped = 0;
+  const int32_t n = locate(0, CAPACITY, first, t, dropped);
+  out.print('[');
+  const uint16_t cnt = n < 0 ? 0 : writeItems(out, (uint16_t)n, first, t, false);
+  out.print(']');
+  return cnt;
+}
+
+size_t LOGR::writeSince(Print &out, uint32_t since, uint16_t max){
+  uint32_t first = 0, t = 0, dropped = 0;
+  const int32_t n = locate(since, max ? max : 1, first, t, dropped);
+  // không chốt được vùng đọc: trả rỗng, seq = since để client hỏi lại đúng chỗ cũ
+  if (n < 0) { first = since; dropped = 0; }
+  out.print("{\"items\":[");
+  const uint16_t cnt = n < 0 ? 0 : writeItems(out, (uint16_t)n, first, t, true);
+  // seq ghi sau items: lô bị push ghi chen làm dừng sớm thì client hỏi tiếp từ bản chưa nhận
+  char buf[64];
+  snprintf(buf, sizeof(buf), "],\"seq\":%lu,\"dropped\":%lu}", (unsigned long)(first + cnt), (unsigned long)dropped);
+  out.print(buf);
   return cnt;
 }
 
-void LOGR::clear(){ head = 0; }
\ No newline at end of file
+void LOGR::clear(){ __atomic_store_n(&floor_seq, __atomic_load_n(&head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE); }
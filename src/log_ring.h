@@ -1,13 +1,43 @@
 #pragma once
 #include <Arduino.h>
 
+enum class LogOut : uint8_t { IGN = 0, INJ = 1 };
+enum class LogWhy : uint8_t { SHIFT = 0, BACKFIRE = 1, LIMITER = 2, LOCK = 3, TEST = 4, OTHER = 7 }; // 3 bit
+
+// Bản ghi đầy đủ (giao tiếp push); trong ring chỉ lưu dạng nén LogRec
 struct LogItem {
-  uint32_t ts_ms; uint16_t rpm; uint16_t cut_ms; bool auto_mode; bool backfire; char out[4]; char reason[8];
+  uint32_t ts_ms; uint16_t rpm; uint16_t cut_ms; bool auto_mode; bool backfire; LogOut out; LogWhy why;
+};
+
+// Bản ghi nén 6 byte: thời gian lưu dạng delta so với bản ghi trước (ring giữ mốc tuyệt đối
+// của bản mới nhất), chuỗi out/why chỉ được giải mã khi xuất JSON cho web.
+//  flags: bit0 out (INJ), bit1 auto, bit2 backfire, bit3..5 why, bit6..7 thang dt
+//         (dt × 1 / 16 / 256 / 4096 ms → khoảng trống tới ~74 h, độ phân giải giảm khi dài)
+struct __attribute__((packed)) LogRec {
+  uint16_t dt;
+  uint16_t rpm;
+  uint8_t  cut_ms;   // bão hoà 255 (CUT_MS_MAX = 150)
+  uint8_t  flags;
 };
+static_assert(sizeof(LogRec) == 6, "LogRec must stay 6 bytes");
 
 namespace LOGR {
+  static constexpr uint16_t CAPACITY = 256;
+
   void begin();
   void push(const LogItem &it);
-  size_t readAllToJson(String &out);
-  void clear();
+  void clear();      // ẩn các bản ghi hiện có, số thứ tự vẫn tăng tiếp
+
+  // Mỗi bản ghi có số thứ tự (seq) tăng đơn điệu từ begin(); seq() = số của bản ghi kế tiếp.
+  uint32_t seq();
+
+  // Ghi thẳng JSON vào out (không qua String). Trả về số bản ghi đã ghi.
+  //  writeAll  : [{...}, ...] toàn bộ ring (cũ trước)
+  //  writeSince: {"items":[{...,"s":<seq>}, ...],"seq":<next>,"dropped":<n>} các bản ghi seq >= since,
+  //              tối đa max (cũ trước); dropped = số bản ghi đã bị ghi đè trước khi client kịp lấy.
+  //              Client gọi lại với since = seq trả về.
+  //  Đọc theo lô 16 bản ghi; push ghi chen liên tục (4 lần thử) → dừng ở lô đó (có thể 0 bản
+  //  ghi), writeSince trả seq = bản đầu chưa gửi (hỏi lại sau). Không bao giờ ghi bản ghi rách.
+  size_t writeAll(Print &out);
+  size_t writeSince(Print &out, uint32_t since, uint16_t max = CAPACITY);
 }
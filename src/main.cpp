@@ -11,17 +11,32 @@
 #include "lock_guard.h"  // dùng LOCK từ lock_guard.cpp
 #include "Backfire.h"
 #include "ota_manager.h"
+#include "persist_log.h"
 
 // 1) Tạo instance:
 BackfireController backfire;
 // Callbacks cho BackfireController
 static uint16_t QS_GetRPM()            { return RPM::get(); }
 static bool     QS_IsCutBusy()         { return CUT::isActive(); } // đủ để tránh chồng xung
-static void     QS_RequestIgnCut(uint16_t ms) { 
-  if (LOCK::isLocked()) return;        // khi khóa: chặn mọi cắt
-  CUT::pulse(CutLine::IGN, ms);        // không chặn loop
+static bool     QS_PlayIgn(uint32_t t0_us, const CUT::Timeline& tl) {
+  if (LOCK::isLocked()) return false;  // khi khóa: chặn mọi cắt
+  return CUT::play(CutLine::IGN, CutPrio::BACKFIRE, t0_us, tl); // timer phát, QS/lock thắng
+}
+static bool     QS_IsIgnMode()         { return CFG::snapshot().cut_output == CutOutputSel::IGN; }
+static int32_t  QS_GetAccel()          { return RPM::accel(); }   // dRPM/dt từ bộ ước lượng
+
+static void     QS_OnCut(uint32_t end_us) { backfire.onShiftCut(end_us); }
+
+static BackfireController::Config BF_FromCfg(const QSConfig& c) {
+  BackfireController::Config b;
+  b.enabled = c.bf_enable;           b.ign_only = c.bf_ign_only;   b.mode = c.bf_mode;
+  b.rpm_min = c.bf_rpm_min;          b.rpm_max = c.bf_rpm_max;     b.warmup_s = c.bf_warmup_s;
+  b.decel_thresh_rpm_s = c.bf_decel_thresh;
+  b.window_after_shift_ms = c.bf_window_ms;
+  b.burst_count = c.bf_burst_count;  b.burst_on_ms = c.bf_burst_on; b.burst_off_ms = c.bf_burst_off;
+  b.refractory_ms = c.bf_refractory_ms;
+  return b;
 }
-static bool     QS_IsIgnMode()         { return CFG::get().cut_output == CutOutputSel::IGN; }
 
 /*
 
@@ -63,23 +78,31 @@ void setup(){
   WEB::beginPortal();     // AP at boot; tự tắt theo ap_timeout_s
   LOCK::begin();          // bật cơ chế khóa theo config
   OTA_MGR::begin();       // khởi tạo OTA Manager
+  PLOG::begin();          // nhật ký phiên trên LittleFS (sau WEB::beginPortal đã mount)
 
   
   const auto& c = CFG::get();
-
-// Backfire OFF mặc định theo yêu cầu
-// TODO: Implement backfire nếu cần thiết
-
+  backfire.begin(BF_FromCfg(c), QS_GetRPM, QS_IsCutBusy, QS_PlayIgn, QS_IsIgnMode, QS_GetAccel);
+  CTRL::setCutHook(QS_OnCut);
 }
 
 void loop(){
+  // Ghim bản config cho cả vòng loop (set() từ task web không ghi đè bản đang dùng)
+  CFG::acquire();
+
   // Ưu tiên xử lý khóa
   LOCK::tick();
   
-  // Luôn gọi CUT::tick() để xử lý pulse timing
+  // CUT::tick(): lưới an toàn, nhả cắt do timer one-shot đảm nhiệm
   CUT::tick();
+  // Rút các cạnh RPM đã bắt (theo lô)
+  RPM::tick();
+  // Nhật ký phiên: chỉ copy vào RAM, task riêng ghi flash
+  PLOG::tick(RPM::get());
   
   if (LOCK::isLocked()){
+    CTRL::disarm();
+    CUT::stopTimeline(CutLine::IGN);
     WEB::loop(); // vẫn cho cấu hình khi đang khóa
     // heartbeat
     static uint32_t t0=0; 
@@ -97,6 +120,11 @@ void loop(){
 
   // QS bình thường
   CTRL::tick();
+
+  // Backfire: chỉ quyết định ở đây, nhịp on/off do timer của CUT phát
+  static uint32_t bfVer = 0;
+  if (CFG::pinnedVersion() != bfVer) { bfVer = CFG::pinnedVersion(); backfire.setConfig(BF_FromCfg(CFG::snapshot())); }
+  backfire.tick(CUT::nowUs());
   WEB::loop();
 
   // heartbeat
@@ -106,9 +134,4 @@ void loop(){
     digitalWrite(PIN_STATUS_LED, !digitalRead(PIN_STATUS_LED)); 
   }
 }
-// GỌI HÀM NÀY Ở CHỖ VỪA NHẢ QUICKSHIFT CUT
-// (ngay sau khi bạn tắt rơ-le QS)
-static inline void onQuickshiftCutReleased_hook(uint32_t now) {
-  // TODO: Implement backfire hook nếu cần thiết
-}
 
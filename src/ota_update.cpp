@@ -4,6 +4,7 @@
 #include <ArduinoJson.h>
 #include <esp_ota_ops.h>
 #include "ota_manager.h"
+#include "persist_log.h"
 
 // Serial log helper
 #define SLOGln(x)  do{ Serial.println(x); }while(0)
@@ -132,6 +133,7 @@ void OTAHTTP_registerRoutes(AsyncWebServer& server){
       } else {
         // Set pending validation
         OTA_MGR::markPending();
+        PLOG::flush(); // loop + task ghi lưu nốt nhật ký trong lúc chờ reboot
         sendJSON(req, 200, "FW ok, rebooting...");
         req->client()->close(true);
         delay(s_reboot_delay_ms);
@@ -0,0 +1,159 @@
+#include "persist_log.h"
+#include "persist_log_io.h"
+#include "cut_output.h"
+
+static const char *const DIR = "/plog";
+static constexpr size_t   HDR = 16;
+static constexpr uint16_t PER_PAGE = (PLOG::PAGE - HDR) / sizeof(PLOG::Rec);
+
+enum : uint8_t { PG_FREE = 0, PG_FILL = 1, PG_READY = 2 };
+
+// 2 trang: loop ghi trang đang FILL, worker ghi trang READY rồi trả về FREE
+static uint8_t  s_page[2][PLOG::PAGE];
+static uint8_t  s_state[2] = {PG_FREE, PG_FREE};
+static int8_t   s_fill = -1;            // trang đang gom (-1 = cả 2 đang chờ ghi)
+static uint16_t s_n = 0;                // số bản ghi trong trang đang gom
+static uint32_t s_seq = 0;              // số trang đã niêm phong
+static uint32_t s_sealMs = 0, s_telemMs = 0;
+static bool     s_ok = false;
+static volatile bool s_flushReq = false;
+static volatile bool s_held = false;    // worker đã hoãn ghi vì đang có xung cắt hẹn giờ
+
+// thống kê (worker ghi, loop/web đọc)
+static volatile uint32_t s_bytes = 0, s_pages = 0, s_lastUs = 0, s_maxUs = 0, s_dropped = 0, s_deferred = 0;
+static uint64_t s_busyUs = 0;
+static volatile uint32_t s_seg = 0;
+static volatile uint8_t  s_qmax = 0;
+
+static inline uint8_t ld(const uint8_t &v){ return __atomic_load_n(&v, __ATOMIC_ACQUIRE); }
+static inline void    st(uint8_t &v, uint8_t x){ __atomic_store_n(&v, x, __ATOMIC_RELEASE); }
+
+static void segPath(char *buf, size_t n, uint32_t idx){ snprintf(buf, n, "%s/s%05lu.bin", DIR, (unsigned long)idx); }
+
+// Xoá mọi segment có chỉ số <= s_seg - SEG_MAX: chỉ giữ SEG_MAX file mới nhất kể cả s_seg.
+// Quét từ chỉ số nhỏ nhất còn trên flash nên khoảng trống (nhiều lần khởi động ngắn, xoá
+// lỗi trước đó) cũng được dọn hết.
+static void prune(){
+  if (s_seg < PLOG::SEG_MAX) return;
+  const int32_t lo = PLOGIO::minIndex(DIR);
+  if (lo < 0) return;
+  char old[32];
+  for (uint32_t i = (uint32_t)lo; i <= s_seg - PLOG::SEG_MAX; i++) {
+    segPath(old, sizeof(old), i);
+    PLOGIO::remove(old);
+  }
+}
+
+// ---- worker (task ghi) ----
+// Ghi/xoá LittleFS tắt cache flash: trên ESP32-C3 (1 nhân) task esp_timer nhả cắt cũng bị
+// treo theo → mỗi trang ghi trong CUT::flashLock(): chỉ khoá được khi không có xung hẹn giờ,
+// và trong lúc khoá không xung mới nào bắt đầu (QS chờ tới khi ghi xong). Không khoá được
+// thì hoãn, tick() đánh thức lại sau.
+static void writePages(){
+  for (uint8_t i = 0; i < 2; i++) {
+    if (ld(s_state[i]) != PG_READY) continue;
+    if (!CUT::flashLock()) { s_held = true; s_deferred = s_deferred + 1; return; }
+    char path[32];
+    segPath(path, sizeof(path), s_seg);
+    if (PLOGIO::fileSize(path) + PLOG::PAGE > PLOG::SEG_BYTES) {
+      s_seg = s_seg + 1;
+      segPath(path, sizeof(path), s_seg);
+      prune();
+    }
+    const uint32_t t0 = PLOGIO::nowUs();
+    const bool ok = PLOGIO::append(path, s_page[i], PLOG::PAGE);
+    const uint32_t dt = PLOGIO::nowUs() - t0;
+    if (ok) {
+      s_bytes = s_bytes + PLOG::PAGE; s_pages = s_pages + 1;
+      s_lastUs = dt; if (dt > s_maxUs) s_maxUs = dt;
+      s_busyUs += dt;
+    }
+    CUT::flashUnlock();
+    st(s_state[i], PG_FREE);
+  }
+}
+
+// ---- loop ----
+static void seal(){
+  if (s_fill < 0 || s_n == 0) return;
+  uint8_t *p = s_page[s_fill];
+  const PLOG::Rec *first = (const PLOG::Rec*)(p + HDR);
+  uint32_t ts0; memcpy(&ts0, &first->ts_ms, 4);
+  p[0] = 'Q'; p[1] = 'S'; p[2] = 'P'; p[3] = 'L';
+  memcpy(p + 4, &s_seq, 4);
+  memcpy(p + 8, &s_n, 2);
+  const uint16_t ver = 1; memcpy(p + 10, &ver, 2);
+  memcpy(p + 12, &ts0, 4);
+  memset(p + HDR + s_n * sizeof(PLOG::Rec), 0xFF, PLOG::PAGE - HDR - s_n * sizeof(PLOG::Rec));
+  s_seq++;
+  st(s_state[s_fill], PG_READY);
+  s_fill = -1; s_n = 0;
+  s_sealMs = millis();
+
+  uint8_t q = (ld(s_state[0]) == PG_READY) + (ld(s_state[1]) == PG_READY);
+  if (q > s_qmax) s_qmax = q;
+  PLOGIO::notify();
+}
+
+void PLOG::begin(){
+  s_ok = PLOGIO::mount(DIR);
+  const int32_t last = s_ok ? PLOGIO::maxIndex(DIR) : -1;
+  s_seg = last < 0 ? 0 : (uint32_t)last + 1;   // mỗi lần khởi động mở segment mới
+  s_seq = s_seg * (SEG_BYTES / PAGE);
+  if (s_ok) prune();                           // segment của các lần khởi động trước
+  s_fill = -1; s_n = 0; s_state[0] = s_state[1] = PG_FREE; s_held = false;
+  s_sealMs = s_telemMs = millis();
+  if (s_ok) s_ok = PLOGIO::startWorker(writePages);
+  Rec b{}; b.ts_ms = millis(); b.flags = (uint8_t)Kind::BOOT;
+  push(b);
+}
+
+void PLOG::push(const Rec &r){
+  if (!s_ok) return;
+  if (s_fill < 0) {
+    for (uint8_t i = 0; i < 2 && s_fill < 0; i++) {
+      if (ld(s_state[i]) == PG_FREE) { s_fill = (int8_t)i; s_state[i] = PG_FILL; s_n = 0; }
+    }
+    if (s_fill < 0) { s_dropped = s_dropped + 1; return; }
+  }
+  memcpy(s_page[s_fill] + HDR + s_n * sizeof(Rec), &r, sizeof(Rec));
+  if (++s_n >= PER_PAGE) seal();
+}
+
+void PLOG::logCut(const LogItem &it){
+  Rec r{};
+  r.ts_ms = it.ts_ms; r.rpm = it.rpm;
+  r.cut_ms = it.cut_ms > 255 ? 255 : (uint8_t)it.cut_ms;
+  r.flags = (uint8_t)((uint8_t)Kind::CUT | (it.out == LogOut::INJ ? 0x04 : 0) | (it.auto_mode ? 0x08 : 0) |
+                      (it.backfire ? 0x10 : 0) | (((uint8_t)it.why & 0x07) << 5));
+  push(r);
+}
+
+void PLOG::tick(uint16_t rpm){
+  if (!s_ok) return;
+  const uint32_t now = millis();
+  if (now - s_telemMs >= TELEM_MS) {
+    s_telemMs += TELEM_MS;
+    if (now - s_telemMs >= TELEM_MS) s_telemMs = now; // loop bị trễ lâu: không bù mẫu
+    Rec r{}; r.ts_ms = now; r.rpm = rpm; r.flags = (uint8_t)Kind::TELEM;
+    push(r);
+  }
+  if (s_n && (s_flushReq || now - s_sealMs >= FLUSH_MS)) seal();
+  s_flushReq = false;
+  if (s_held && !CUT::pending()) { s_held = false; PLOGIO::notify(); }
+}
+
+void PLOG::flush(){ s_flushReq = true; }
+
+PLOG::Stats PLOG::stats(){
+  Stats s{};
+  s.bytes = s_bytes; s.pages = s_pages; s.last_write_us = s_lastUs; s.max_write_us = s_maxUs;
+  s.kBps = s_busyUs ? (uint32_t)((uint64_t)s_bytes * 1000ULL / s_busyUs) : 0;
+  s.queue = (ld(s_state[0]) == PG_READY) + (ld(s_state[1]) == PG_READY);
+  s.queue_max = s_qmax;
+  s.dropped = s_dropped;
+  s.deferred = s_deferred;
+  s.segment = s_seg;
+  s.ok = s_ok;
+  return s;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include "log_ring.h"
+
+// ===== Nhật ký phiên lưu trên LittleFS =====
+// Bản ghi 8 byte được gom vào 1 trong 2 trang RAM 4096 byte (double buffer). Trang đầy (hoặc
+// đến hạn flush) được niêm phong và giao cho task ghi qua PLOGIO; loop không bao giờ chạm
+// flash. Mỗi lần ghi đúng 1 trang (căn theo block LittleFS) vào cuối segment hiện tại
+// /plog/sNNNNN.bin (chỉ append); segment đủ SEG_BYTES thì sang file mới, giữ SEG_MAX file.
+// Cả 2 trang đều đang chờ ghi → bản ghi mới bị bỏ và đếm vào dropped.
+// Mỗi trang được ghi trong CUT::flashLock() (flash bận làm trễ nhả cắt, xem cut_output.h):
+// đang có xung hẹn giờ thì trang chờ tới khi hết xung; đang ghi thì xung mới chờ trang ghi xong.
+//
+// Trang: header 16 byte 'Q','S','P','L' | seq u32 | n u16 | ver u16 (=1) | ts_ms u32 (bản đầu)
+//        rồi n × Rec, phần còn lại 0xFF.
+namespace PLOG {
+  static constexpr size_t   PAGE = 4096;
+  static constexpr uint32_t SEG_BYTES = 64UL * 1024UL;
+  static constexpr uint8_t  SEG_MAX = 8;          // 512 KB trên flash
+  static constexpr uint16_t TELEM_MS = 100;       // chu kỳ mẫu telemetry
+  static constexpr uint16_t FLUSH_MS = 30000;     // trang chưa đầy vẫn được ghi sau khoảng này (mất tối đa 30 s khi tắt máy)
+
+  enum class Kind : uint8_t { CUT = 0, TELEM = 1, BOOT = 2 };
+
+  //  flags: bit0..1 kind, bit2 out (INJ), bit3 auto, bit4 backfire, bit5..7 why (LogWhy)
+  struct __attribute__((packed)) Rec {
+    uint32_t ts_ms;
+    uint16_t rpm;
+    uint8_t  cut_ms;
+    uint8_t  flags;
+  };
+  static_assert(sizeof(Rec) == 8, "PLOG::Rec must stay 8 bytes");
+
+  struct Stats {
+    uint32_t bytes;         // đã ghi xuống flash
+    uint32_t pages;
+    uint32_t last_write_us; // thời gian append trang cuối
+    uint32_t max_write_us;
+    uint32_t kBps;          // thông lượng khi ghi (byte / thời gian ghi)
+    uint8_t  queue;         // số trang đang chờ ghi (0..2)
+    uint8_t  queue_max;
+    uint32_t dropped;       // bản ghi bị bỏ do cả 2 trang đều chờ ghi
+    uint32_t deferred;      // số lần hoãn ghi vì đang có xung cắt
+    uint32_t segment;       // chỉ số segment hiện tại
+    bool     ok;            // mount + worker chạy được
+  };
+
+  void begin();
+  void push(const Rec &r);                 // loop, không chặn
+  void logCut(const LogItem &it);          // bản ghi CUT từ cùng dữ liệu với LOGR
+  void tick(uint16_t rpm);                 // loop: mẫu telemetry + flush theo hạn
+  void flush();                            // yêu cầu ghi trang đang gom ở tick() kế tiếp (gọi từ task
+                                           // bất kỳ, vd. web trước khi reboot sau OTA)
+  Stats stats();
+}
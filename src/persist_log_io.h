@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Backend lưu trữ cho PLOG =====
+// Worker chạy trong task riêng (ưu tiên thấp), chờ notify() rồi gọi hàm ghi của PLOG:
+// mọi thao tác flash nằm ở task này, loop chỉ copy vào RAM và đánh thức.
+//  - persist_log_io_esp.cpp  (ARDUINO): LittleFS + task FreeRTOS
+//  - persist_log_io_host.cpp (host)   : thư mục trên đĩa thay LittleFS + std::thread,
+//                                        có thể giả lập thời gian ghi flash
+namespace PLOGIO {
+  using Worker = void (*)();
+
+  bool     mount(const char *dir);             // tạo thư mục nếu chưa có
+  bool     startWorker(Worker fn);
+  void     notify();                           // đánh thức worker, không chặn
+  bool     append(const char *path, const uint8_t *data, size_t len);
+  uint32_t fileSize(const char *path);         // 0 nếu không có
+  bool     remove(const char *path);
+  int32_t  maxIndex(const char *dir);          // chỉ số lớn nhất của file sNNNNN.bin, -1 nếu không có
+  int32_t  minIndex(const char *dir);          // chỉ số nhỏ nhất, -1 nếu không có
+  uint32_t nowUs();
+
+  // Chỉ có ở backend host
+  void     simWriteDelayUs(uint32_t us);       // thời gian giả lập cho mỗi append
+  void     stopWorker();                       // chờ worker xử lý hết rồi dừng
+}
@@ -0,0 +1,82 @@
+#ifdef ARDUINO
+#include "persist_log_io.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_timer.h>
+
+// LittleFS ghi theo block 4096 byte: mỗi append 1 trang = 1 block mới, không đọc-sửa-ghi.
+// Task ghi ưu tiên 1 (ngang loop). Khi erase/ghi flash, cache bị tắt: trên ESP32-C3 (1 nhân)
+// mọi task và ISR không nằm trong IRAM đều đứng chờ, kể cả task esp_timer nhả cắt
+// (cut_timer_esp.cpp). Vì vậy PLOG ghi từng trang trong CUT::flashLock(): không ghi khi còn
+// xung hẹn giờ, và không xung mới nào bắt đầu trong lúc ghi — cạnh trigger tới giữa chừng
+// chỉ bị trễ lúc bắt đầu cắt, tối đa thời gian ghi 1 trang (plog_write_max_us).
+
+static TaskHandle_t    s_task = nullptr;
+static PLOGIO::Worker  s_fn = nullptr;
+
+static void workerTask(void*){
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (s_fn) s_fn();
+  }
+}
+
+bool PLOGIO::mount(const char *dir){
+  if (!LittleFS.begin(false)) { Serial.println("[PLOG] LittleFS mount failed"); return false; }
+  if (!LittleFS.exists(dir)) LittleFS.mkdir(dir);
+  return true;
+}
+
+bool PLOGIO::startWorker(Worker fn){
+  s_fn = fn;
+  if (s_task) return true;
+  if (xTaskCreate(workerTask, "plog", 4096, nullptr, 1, &s_task) != pdPASS) {
+    s_task = nullptr; Serial.println("[PLOG] worker task create failed"); return false;
+  }
+  return true;
+}
+
+void PLOGIO::notify(){ if (s_task) xTaskNotifyGive(s_task); }
+
+bool PLOGIO::append(const char *path, const uint8_t *data, size_t len){
+  File f = LittleFS.open(path, "a");
+  if (!f) return false;
+  const size_t n = f.write(data, len);
+  f.close();
+  return n == len;
+}
+
+uint32_t PLOGIO::fileSize(const char *path){
+  if (!LittleFS.exists(path)) return 0;
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+  const uint32_t n = f.size();
+  f.close();
+  return n;
+}
+
+bool PLOGIO::remove(const char *path){ return LittleFS.exists(path) && LittleFS.remove(path); }
+
+// chỉ số nhỏ nhất/lớn nhất của các file sNNNNN.bin trong dir, -1 nếu không có
+static int32_t scanIndex(const char *dir, bool wantMax){
+  int32_t best = -1;
+  File d = LittleFS.open(dir);
+  if (!d || !d.isDirectory()) return -1;
+  for (File f = d.openNextFile(); f; f = d.openNextFile()) {
+    unsigned long idx;
+    const char *name = strrchr(f.name(), '/');
+    name = name ? name + 1 : f.name();
+    if (sscanf(name, "s%5lu.bin", &idx) != 1) continue;
+    if (best < 0 || (wantMax ? (int32_t)idx > best : (int32_t)idx < best)) best = (int32_t)idx;
+  }
+  return best;
+}
+
+int32_t PLOGIO::maxIndex(const char *dir){ return scanIndex(dir, true); }
+int32_t PLOGIO::minIndex(const char *dir){ return scanIndex(dir, false); }
+
+uint32_t PLOGIO::nowUs(){ return (uint32_t)esp_timer_get_time(); }
+
+void PLOGIO::simWriteDelayUs(uint32_t){}
+void PLOGIO::stopWorker(){}
+#endif
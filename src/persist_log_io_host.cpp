@@ -0,0 +1,97 @@
+#ifndef ARDUINO
+#include "persist_log_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Backend host: thư mục PLOG_HOST_ROOT (mặc định ./plog_fs) đóng vai LittleFS, worker là
+// std::thread; simWriteDelayUs() giả lập thời gian ghi 1 block flash.
+
+static std::string root(){ const char *r = getenv("PLOG_HOST_ROOT"); return r ? r : "./plog_fs"; }
+static std::string full(const char *p){ return root() + p; }
+
+static std::thread             s_thr;
+static std::mutex              s_mx;
+static std::condition_variable s_cv;
+static bool     s_pending = false, s_stop = false;
+static PLOGIO::Worker s_fn = nullptr;
+static uint32_t s_delayUs = 0;
+
+bool PLOGIO::mount(const char *dir){
+  mkdir(root().c_str(), 0755);
+  mkdir(full(dir).c_str(), 0755);
+  return true;
+}
+
+bool PLOGIO::startWorker(Worker fn){
+  s_fn = fn;
+  if (s_thr.joinable()) return true;
+  s_stop = false;
+  s_thr = std::thread([]{
+    std::unique_lock<std::mutex> lk(s_mx);
+    for (;;) {
+      s_cv.wait(lk, []{ return s_pending || s_stop; });
+      const bool stop = s_stop;
+      s_pending = false;
+      lk.unlock();
+      if (s_fn) s_fn();
+      lk.lock();
+      if (stop && !s_pending) return;
+    }
+  });
+  return true;
+}
+
+void PLOGIO::notify(){ { std::lock_guard<std::mutex> g(s_mx); s_pending = true; } s_cv.notify_one(); }
+
+bool PLOGIO::append(const char *path, const uint8_t *data, size_t len){
+  if (s_delayUs) std::this_thread::sleep_for(std::chrono::microseconds(s_delayUs));
+  FILE *f = fopen(full(path).c_str(), "ab");
+  if (!f) return false;
+  const size_t n = fwrite(data, 1, len, f);
+  fclose(f);
+  return n == len;
+}
+
+uint32_t PLOGIO::fileSize(const char *path){
+  struct stat st;
+  return stat(full(path).c_str(), &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+bool PLOGIO::remove(const char *path){ return ::remove(full(path).c_str()) == 0; }
+
+static int32_t scanIndex(const char *dir, bool wantMax){
+  int32_t best = -1;
+  DIR *d = opendir(full(dir).c_str());
+  if (!d) return -1;
+  while (dirent *e = readdir(d)) {
+    unsigned long idx;
+    if (sscanf(e->d_name, "s%5lu.bin", &idx) != 1) continue;
+    if (best < 0 || (wantMax ? (int32_t)idx > best : (int32_t)idx < best)) best = (int32_t)idx;
+  }
+  closedir(d);
+  return best;
+}
+
+int32_t PLOGIO::maxIndex(const char *dir){ return scanIndex(dir, true); }
+int32_t PLOGIO::minIndex(const char *dir){ return scanIndex(dir, false); }
+
+uint32_t PLOGIO::nowUs(){
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void PLOGIO::simWriteDelayUs(uint32_t us){ s_delayUs = us; }
+
+void PLOGIO::stopWorker(){
+  { std::lock_guard<std::mutex> g(s_mx); s_stop = true; s_pending = true; }
+  s_cv.notify_one();
+  if (s_thr.joinable()) s_thr.join();
+}
+#endif
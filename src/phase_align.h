@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// ===== Căn pha điểm bắt đầu cắt =====
+// Lần đánh lửa kế tiếp dự báo = cạnh cuối + k·chu kỳ. Cắt bắt đầu LEAD_US trước đó
+// (hoặc ngay nếu đã sát) → lần đánh lửa đầu bị cắt luôn là lần kế tiếp và số lần bị cắt
+// của một xung ms không còn phụ thuộc pha lúc nhấn (lệch tới 1 chu kỳ khi bắt đầu ngay).
+// Chu kỳ đổi chậm so với 1 vòng nên dùng chu kỳ lúc lập kế hoạch là đủ.
+// Chỉ là phép tính thuần (không state) để ISR gọi được và test host kiểm trên mô hình động cơ.
+namespace PHASE {
+  static constexpr uint32_t LEAD_US = 300;
+
+  // Lần đánh lửa kế tiếp sau now, false nếu không dự báo được (mất cạnh)
+  __attribute__((always_inline)) inline bool predictNext(uint32_t last_edge, uint32_t now, uint32_t per, uint32_t &next){
+    const uint32_t since = now - last_edge;
+    if (!per || since > 2 * per) return false;
+    next = last_edge + (since / per + 1) * per;
+    return true;
+  }
+
+  // Điểm bắt đầu cắt: LEAD_US trước lần đánh lửa dự báo, hoặc now nếu đã sát/không dự báo
+  __attribute__((always_inline)) inline uint32_t startAt(uint32_t now, bool pred, uint32_t next){
+    return (pred && next - now > LEAD_US) ? next - LEAD_US : now;
+  }
+}
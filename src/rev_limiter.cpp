@@ -0,0 +1,106 @@
+#include "rev_limiter.h"
+#include <Arduino.h>
+
+// Ngưỡng trong miền chu kỳ (µs): rpm >= R  <=>  dt <= K / R
+struct Thresholds {
+  uint32_t soft_in, soft_out, hard_in, hard_out;
+  uint8_t  soft_cut, soft_of, hard_cut, hard_of;
+};
+
+static volatile bool s_enable = false;
+static volatile bool s_launch = false;
+static bool       s_launch_en = false;
+static bool       s_lim_en = false;
+static bool       s_blocked = false;
+static CutLine    s_line = CutLine::IGN;
+static uint32_t   s_k = 60000000UL;
+static Thresholds s_th[2];          // [0] = limiter thường, [1] = launch
+static volatile uint8_t s_sel = 0;  // bảng đang dùng (đổi nguyên tử, ISR chỉ đọc)
+
+// trạng thái ISR
+static uint32_t s_last = 0;
+static bool     s_have = false;
+static LIMIT::Zone s_zone = LIMIT::Zone::NONE;
+static uint8_t  s_cnt = 0;          // đếm lần đánh lửa trong chu kỳ mẫu cắt
+static volatile uint32_t s_cuts = 0;
+static volatile uint32_t s_min_dt = 0;
+
+static inline uint32_t toPeriod(uint32_t k, uint16_t rpm){ return rpm ? k / rpm : 0xFFFFFFFFUL; }
+
+static void build(Thresholds &t, uint32_t k, uint16_t hard, uint16_t soft, uint16_t hyst, const LIMIT::Params &p){
+  if (soft > hard) soft = hard;
+  t.hard_in  = toPeriod(k, hard);
+  t.hard_out = toPeriod(k, hard > hyst ? hard - hyst : 1);
+  t.soft_in  = toPeriod(k, soft);
+  t.soft_out = toPeriod(k, soft > hyst ? soft - hyst : 1);
+  t.soft_of  = p.soft_of ? p.soft_of : 1;
+  t.soft_cut = p.soft_cut > t.soft_of ? t.soft_of : p.soft_cut;
+  t.hard_of  = p.hard_of ? p.hard_of : 1;
+  t.hard_cut = p.hard_cut > t.hard_of ? t.hard_of : p.hard_cut;
+}
+
+bool LIMIT::configure(const Params &p, uint32_t k_rpm_us){
+  s_enable = false; // ISR bỏ qua trong lúc dựng lại ngưỡng
+  s_k = k_rpm_us;
+  s_line = p.line;
+  build(s_th[0], s_k, p.hard_rpm, p.soft_rpm, p.hyst_rpm, p);
+  const uint16_t gap = p.hard_rpm > p.soft_rpm ? p.hard_rpm - p.soft_rpm : 0;
+  build(s_th[1], s_k, p.launch_rpm, p.launch_rpm > gap ? p.launch_rpm - gap : 0, p.hyst_rpm, p);
+  s_launch_en = p.launch_enable;
+  s_lim_en = p.enable;
+  s_sel = (s_launch && s_launch_en) ? 1 : 0;
+  s_zone = Zone::NONE; s_cnt = 0; s_have = false;
+  s_blocked = (p.enable || p.launch_enable) && p.rpm_on_line;
+  s_enable = (p.enable || p.launch_enable) && !s_blocked;
+  return !s_blocked;
+}
+
+void LIMIT::armLaunch(bool on){
+  s_launch = on;
+  s_sel = (on && s_launch_en) ? 1 : 0;
+}
+
+void IRAM_ATTR LIMIT::onEdge(uint32_t t){
+  if (!s_enable) { s_have = false; return; }
+  const uint32_t dt = t - s_last;
+  const bool ok = s_have;
+  s_last = t; s_have = true;
+  if (!ok) return;
+
+  const uint8_t sel = s_sel;
+  if (sel == 0 && !s_lim_en) { s_zone = LIMIT::Zone::NONE; return; } // chỉ bật launch, chưa arm
+  const Thresholds &th = s_th[sel];
+  // vùng hiện tại với trễ
+  Zone z = s_zone;
+  if (dt <= th.hard_in) z = Zone::HARD;
+  else if (z == Zone::HARD && dt < th.hard_out) z = Zone::HARD;
+  else if (dt <= th.soft_in) z = Zone::SOFT;
+  else if (z != Zone::NONE && dt < th.soft_out) z = Zone::SOFT;
+  else z = Zone::NONE;
+  if (z != s_zone) { s_zone = z; s_cnt = 0; }
+  if (z == Zone::NONE) return;
+
+  if (!s_min_dt || dt < s_min_dt) s_min_dt = dt;
+  const uint8_t cut = (z == Zone::HARD) ? th.hard_cut : th.soft_cut;
+  const uint8_t of  = (z == Zone::HARD) ? th.hard_of  : th.soft_of;
+  const bool skip = s_cnt < cut;
+  if (++s_cnt >= of) s_cnt = 0;
+  if (skip) {
+    CUT::requestAt(s_line, CutPrio::LIMITER, t, dt + dt / 2);
+    s_cuts = s_cuts + 1;
+  }
+}
+
+LIMIT::Stats LIMIT::stats(){
+  Stats s{};
+  s.cuts = s_cuts;
+  const uint32_t m = s_min_dt;
+  const uint32_t r = m ? s_k / m : 0;
+  s.peak_rpm = (uint16_t)(r > 65535 ? 65535 : r);
+  s.zone = s_zone;
+  s.launch = s_sel == 1;
+  s.blocked = s_blocked;
+  return s;
+}
+
+void LIMIT::resetStats(){ s_cuts = 0; s_min_dt = 0; }
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include "cut_output.h"
+
+// ===== Rev limiter / launch control =====
+// Quyết định theo TỪNG cạnh đánh lửa trong hook ISR capture (không chờ loop): chu kỳ vừa đo
+// được so thẳng với ngưỡng đã đổi sang miền chu kỳ (không phép chia trong ISR).
+//  - vùng SOFT  (rpm >= soft): cắt soft_cut trên soft_of lần đánh lửa
+//  - vùng HARD  (rpm >= hard): cắt hard_cut trên hard_of (mặc định 1/1 = cắt hết)
+//  - trễ (hysteresis): chỉ rời vùng khi rpm < ngưỡng - hyst
+// Mỗi lần cắt là 1 yêu cầu CUT ưu tiên LIMITER dài 1.5 chu kỳ (phủ đúng lần đánh lửa kế).
+// Launch: khi armLaunch(true), ngưỡng hard = launch_rpm (soft dời theo cùng khoảng cách).
+// Cần nguồn rpm không bị chính line cắt làm mất cạnh: lấy rpm từ coil mà lại cắt IGN thì mỗi
+// lần cắt mất 1 cạnh, chu kỳ đo được gấp đôi → rơi khỏi vùng, 1/1 thành 1/2. Tổ hợp này bị
+// từ chối (rpm_on_line): configure() trả false, limiter/launch không cắt, stats().blocked.
+namespace LIMIT {
+  struct Params {
+    bool     enable;
+    uint16_t hard_rpm, soft_rpm, hyst_rpm;
+    uint8_t  soft_cut, soft_of;
+    uint8_t  hard_cut, hard_of;
+    bool     launch_enable;
+    uint16_t launch_rpm;
+    CutLine  line;
+    bool     rpm_on_line;  // cạnh rpm lấy từ chính line cắt (COIL + IGN)
+  };
+  enum class Zone : uint8_t { NONE = 0, SOFT = 1, HARD = 2 };
+
+  struct Stats {
+    uint32_t cuts;      // số lần đánh lửa bị cắt
+    uint16_t peak_rpm;  // rpm cao nhất khi limiter đang can thiệp (reset bằng resetStats)
+    Zone     zone;
+    bool     launch;
+    bool     blocked;   // bật nhưng bị từ chối vì rpm_on_line
+  };
+
+  // k_rpm_us = hằng số rpm·µs của RPM (RPM::rpmConst()), gọi trong loop khi config đổi.
+  // false nếu bị từ chối (rpm_on_line).
+  bool configure(const Params &p, uint32_t k_rpm_us);
+  void armLaunch(bool on);
+  void onEdge(uint32_t t_us); // hook cạnh RPM (ISR), IRAM
+  Stats stats();
+  void resetStats();
+}
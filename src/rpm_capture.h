@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Backend bắt cạnh RPM =====
+// Backend ghi timestamp (µs) của từng cạnh vào EdgeRing, RPM::tick() rút ra theo lô.
+//  - rpm_capture_esp.cpp    (ARDUINO): ISR GPIO nằm trong IRAM, mức ưu tiên cao,
+//                                      chỉ đọc systimer rồi đẩy vào ring.
+//  - rpm_capture_replay.cpp (host)   : phát lại chuỗi xung đã ghi để kiểm thử trên Linux.
+namespace CAP {
+  // COIL: chỉ cạnh lên. INJECTOR: cả 2 cạnh — cạnh lên (kim mở) vào ring để tính rpm,
+  // cạnh xuống đầu tiên sau đó cho độ rộng xung phun (on-time).
+  enum class Mode : uint8_t { COIL = 0, INJECTOR = 1 };
+
+  // Gọi trong ISR (phải nằm trong IRAM) cho mỗi cạnh được nhận sau blanking
+  using EdgeHook = void (*)(uint32_t t_us);
+
+  void     begin(uint8_t pin);
+  void     setMode(Mode m);
+  size_t   drain(uint32_t *out, size_t max); // cũ trước, trả về số cạnh (chỉ RPM::tick gọi)
+  size_t   latest(uint32_t *out, size_t n, uint32_t *seq = nullptr); // n cạnh mới nhất, mới trước
+  uint32_t nowUs();                          // cùng timeline với timestamp cạnh
+  uint32_t overruns();                       // số cạnh mất do drain trễ
+  void     setBlankUs(uint32_t us);          // cửa sổ blanking sau mỗi cạnh được nhận (0 = tắt)
+  uint32_t blanked();                        // số cạnh bị blanking loại trong ISR
+  uint32_t widthWord();                      // INJECTOR: (số xung << 16) | on-time µs (bão hoà 65535)
+  void     setEdgeHook(EdgeHook hook);       // nullptr = tắt
+
+  // Chỉ có ở backend replay (host)
+  // widths_us (tuỳ chọn): on-time của từng xung → phát thêm cạnh xuống ở chế độ INJECTOR
+  void     replayLoad(const uint32_t *edges_us, size_t n, const uint32_t *widths_us = nullptr);
+  void     replayAdvance(uint32_t now_us);   // đẩy các cạnh có t <= now_us vào ring
+}
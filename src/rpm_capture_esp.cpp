@@ -0,0 +1,67 @@
+#ifdef ARDUINO
+#include "rpm_capture.h"
+#include "edge_ring.h"
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <esp_timer.h>
+
+// ESP32-C3 không có MCPWM capture/PCNT, còn RMT RX (driver legacy) chỉ trả frame khi
+// tín hiệu idle → với xung coil liên tục sẽ không bao giờ có dữ liệu.
+// Vì vậy dùng ngắt GPIO cấp thấp: cài ISR service với IRAM + LEVEL3 để ngắt vẫn chạy khi
+// flash đang ghi (NVS) và không bị Wi-Fi chặn, ISR chỉ đọc systimer và push vào ring.
+
+static EdgeRing<64> s_ring;
+static EdgeBlanker  s_blank;
+static PulseWidth   s_width;
+static uint8_t      s_pin = 0;
+static volatile bool s_both = false; // INJECTOR: ngắt cả 2 cạnh
+static volatile CAP::EdgeHook s_hook = nullptr;
+
+static void IRAM_ATTR capIsr(void*){
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  if (s_both && !gpio_ll_get_level(&GPIO, (gpio_num_t)s_pin)) { s_width.close(now); return; }
+  if (s_blank.accept(now)) {
+    s_ring.push(now); s_width.open(now);
+    const CAP::EdgeHook h = s_hook;
+    if (h) h(now);
+  }
+}
+
+void CAP::begin(uint8_t pin){
+  s_pin = pin;
+  gpio_config_t io = {};
+  io.pin_bit_mask = 1ULL << pin;
+  io.mode         = GPIO_MODE_INPUT;
+  io.pull_up_en   = GPIO_PULLUP_ENABLE;
+  io.pull_down_en = GPIO_PULLDOWN_DISABLE;
+  io.intr_type    = GPIO_INTR_POSEDGE;
+  gpio_config(&io);
+
+  // ESP_ERR_INVALID_STATE = service đã được cài (attachInterrupt của Arduino dùng chung)
+  esp_err_t e = gpio_install_isr_service(ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL3);
+  if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) {
+    Serial.printf("[RPM] gpio_install_isr_service failed: %d\n", (int)e);
+  }
+  s_ring.clear(); s_blank.clear(); s_width.clear();
+  gpio_isr_handler_add((gpio_num_t)pin, capIsr, nullptr);
+}
+
+void CAP::setMode(Mode m){
+  s_both = (m == Mode::INJECTOR);
+  s_width.clear();
+  gpio_set_intr_type((gpio_num_t)s_pin, s_both ? GPIO_INTR_ANYEDGE : GPIO_INTR_POSEDGE);
+}
+
+size_t   CAP::drain(uint32_t *out, size_t max){ return s_ring.drain(out, max); }
+size_t   CAP::latest(uint32_t *out, size_t n, uint32_t *seq){ return s_ring.latest(out, n, seq); }
+uint32_t CAP::nowUs(){ return (uint32_t)esp_timer_get_time(); }
+uint32_t CAP::overruns(){ return s_ring.overruns(); }
+void     CAP::setBlankUs(uint32_t us){ s_blank.setWindow(us); }
+uint32_t CAP::blanked(){ return s_blank.rejected(); }
+uint32_t CAP::widthWord(){ return s_width.word(); }
+void     CAP::setEdgeHook(EdgeHook hook){ s_hook = hook; }
+
+void CAP::replayLoad(const uint32_t*, size_t, const uint32_t*){}
+void CAP::replayAdvance(uint32_t){}
+#endif
@@ -0,0 +1,54 @@
+#ifndef ARDUINO
+#include "rpm_capture.h"
+#include "edge_ring.h"
+
+// Backend host: phát lại chuỗi timestamp cạnh đã ghi (hoặc tổng hợp) qua cùng ring
+// với backend ESP, để kiểm tra độ chính xác/CPU của RPM:: trên Linux.
+// Thời gian mô phỏng do replayAdvance() điều khiển.
+
+static EdgeRing<64> s_ring;
+static EdgeBlanker  s_blank;
+static PulseWidth   s_width;
+static bool     s_both = false;
+static const uint32_t *s_edges = nullptr;
+static const uint32_t *s_widths = nullptr;
+static size_t   s_count = 0, s_next = 0;
+static bool     s_close_pending = false; // cạnh xuống của xung s_next-1 chưa phát
+static uint32_t s_now = 0;
+static CAP::EdgeHook s_hook = nullptr;
+
+void CAP::begin(uint8_t){ s_ring.clear(); s_blank.clear(); s_width.clear(); }
+void CAP::setMode(Mode m){ s_both = (m == Mode::INJECTOR); s_width.clear(); }
+
+void CAP::replayLoad(const uint32_t *edges_us, size_t n, const uint32_t *widths_us){
+  s_edges = edges_us; s_widths = widths_us; s_count = n; s_next = 0;
+  s_close_pending = false;
+  s_now = n ? edges_us[0] : 0;
+  s_ring.clear(); s_blank.clear(); s_width.clear();
+}
+
+void CAP::replayAdvance(uint32_t now_us){
+  for (;;) {
+    const bool has_close = s_both && s_widths && s_close_pending;
+    const uint32_t t_close = has_close ? s_edges[s_next - 1] + s_widths[s_next - 1] : 0;
+    const bool has_open = s_next < s_count;
+    const uint32_t t_open = has_open ? s_edges[s_next] : 0;
+    if (has_close && (int32_t)(t_close - now_us) <= 0 && (!has_open || (int32_t)(t_close - t_open) <= 0)) {
+      s_width.close(t_close); s_close_pending = false;
+    } else if (has_open && (int32_t)(t_open - now_us) <= 0) {
+      s_next++; s_close_pending = true;
+      if (s_blank.accept(t_open)) { s_ring.push(t_open); s_width.open(t_open); if (s_hook) s_hook(t_open); }
+    } else break;
+  }
+  s_now = now_us;
+}
+
+size_t   CAP::drain(uint32_t *out, size_t max){ return s_ring.drain(out, max); }
+size_t   CAP::latest(uint32_t *out, size_t n, uint32_t *seq){ return s_ring.latest(out, n, seq); }
+uint32_t CAP::nowUs(){ return s_now; }
+uint32_t CAP::overruns(){ return s_ring.overruns(); }
+void     CAP::setBlankUs(uint32_t us){ s_blank.setWindow(us); }
+uint32_t CAP::blanked(){ return s_blank.rejected(); }
+uint32_t CAP::widthWord(){ return s_width.word(); }
+void     CAP::setEdgeHook(EdgeHook hook){ s_hook = hook; }
+#endif
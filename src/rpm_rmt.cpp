@@ -1,35 +1,250 @@
 #include "rpm_rmt.h"
-#include "pins.h"
+#include "rpm_capture.h"
+#include "double_buf.h"
 
-// Simple period-based mock (replace with real RMT if needed now).
-// For skeleton: measure pulse intervals via interrupt on PIN_RPM_IN.
+// Cạnh xung được backend CAP:: bắt và đóng dấu thời gian (xem rpm_capture.h).
+// - snapshot(): đọc thẳng ring (chu kỳ thô) bằng snapshot không khóa.
+// - tick(): consumer duy nhất, rút theo lô, loại nhiễu/outlier rồi cập nhật bộ ước lượng;
+//   chu kỳ đã kiểm tra được công bố qua DoubleBuf → get() gọi được từ mọi task.
 
-static volatile uint32_t last_us = 0;
-static volatile uint32_t period_us = 0;
+static constexpr uint32_t PERIOD_MIN_US = 50;
+static constexpr uint32_t PERIOD_MAX_US = 1000000;
+static constexpr uint32_t TIMEOUT_US    = 500000; // 0.5s
+static constexpr uint32_t RPM_MAX       = 20000;
+
+// Lọc nhiễu coil:
+//  - blanking trong ISR: bỏ cạnh đến sớm hơn BLANK_FRAC × chu kỳ trung vị sau cạnh trước
+//  - outlier: chu kỳ < 0.8× trung vị (gai lọt blanking) hoặc > 1.5× (mất xung) không được
+//    đưa vào bộ lọc; chuỗi ngắn đều nhau / OUTLIER_RUN chu kỳ dài liên tiếp = thay đổi thật.
+//    Ngưỡng dài phải < 2× đủ xa: gai lọt blanking dời mốc của ISR nên cạnh thật ngay sau nó bị
+//    blanking, khoảng kế tiếp ≈ 2 chu kỳ thật — lúc đang tăng tốc chỉ còn ~1.7× trung vị.
+static constexpr uint32_t BLANK_FRAC_Q8 = 102; // 40%
+static constexpr uint8_t  OUTLIER_RUN   = 3;
+
+// trạng thái phía consumer (chỉ dùng trong ngữ cảnh loop)
+static uint32_t last_us = 0;
+static bool     have_last = false;
+static uint32_t hist[3];        // 3 chu kỳ được nhận gần nhất (vòng)
+static uint8_t  hist_n = 0, hist_i = 0;
+static uint32_t pend_us = 0;    // cạnh ngắn bất thường đang chờ xác nhận
+static bool     have_pend = false;
+static uint8_t  long_run = 0;
+static uint32_t st_accepted = 0, st_outliers = 0;
+
+// Tải (INJECTOR): on-time lọc EMA 1/4, cập nhật khi ISR báo xung mới
+static bool     s_inj = false;
+static uint32_t s_width_seen = 0;  // bộ đếm xung (16 bit cao của widthWord) đã xử lý
+static uint32_t s_load_q4 = 0;     // on-time µs Q4 (loop)
+static volatile uint32_t s_load_us = 0;
+
+struct Published { uint32_t last_us; uint32_t period_us; };
+static DoubleBuf<Published> s_pub;
 static float g_ppr = 1.0f; static float g_scale = 1.0f;
+// rpm = g_k / period_us, g_k = 60e6 * scale / ppr (đơn vị rpm·µs).
+// Với ppr >= 0.1 và scale hợp lý g_k nằm gọn trong 32 bit, sai số làm tròn của g_k
+// < 1e-7 tương đối nên không cần phần thập phân → mỗi lần get() chỉ 1 phép chia nguyên.
+static uint32_t g_k = 60000000UL;
+
+// ===== Alpha-beta estimator (fixed-point, C3 không có FPU) =====
+// x: rpm Q8, v: rpm/s. Mỗi chu kỳ đo z = g_k/dt:
+//   x' = x + v*dt ; r = z - x' ; x = x' + a*r ; v = v + b*r/dt
+// a = 3/8, b = 1/16 (gần critically damped: b ≈ a²/(2-a)), hội tụ sau ~10 cạnh.
+static constexpr int32_t EST_A_Q8 = 96;
+static constexpr int32_t EST_B_Q8 = 16;
+static int32_t  est_x_q8 = 0;
+static int32_t  est_v = 0;
+static bool     est_valid = false;
+
+static inline int32_t measQ8(uint32_t dt){
+  const uint32_t q = g_k / dt, r = g_k % dt;
+  const uint32_t z = (q > RPM_MAX ? RPM_MAX : q);
+  return (int32_t)((z << 8) | (q > RPM_MAX ? 0 : (uint32_t)(((uint64_t)r << 8) / dt)));
+}
+
+static void estUpdate(uint32_t dt){
+  const int32_t z = measQ8(dt);
+  if (!est_valid) { est_x_q8 = z; est_v = 0; est_valid = true; return; }
+  const int32_t xp = est_x_q8 + (int32_t)(((int64_t)est_v * dt * 256) / 1000000);
+  const int32_t r  = z - xp;
+  est_x_q8 = xp + (int32_t)(((int64_t)r * EST_A_Q8) >> 8);
+  est_v   += (int32_t)(((int64_t)r * EST_B_Q8 * 1000000) / ((int64_t)dt << 16));
+  if (est_x_q8 < 0) est_x_q8 = 0;
+}
+
+static inline uint32_t histMedian(){
+  if (hist_n < 3) return 0;
+  const uint32_t a = hist[0], b = hist[1], c = hist[2];
+  return (a > b) ? ((b > c) ? b : (a > c ? c : a)) : ((a > c) ? a : (b > c ? c : b));
+}
 
-static void IRAM_ATTR isr(){
-  uint32_t now = micros();
-  uint32_t dt = now - last_us; last_us = now; if (dt>50 && dt<1000000) period_us = dt;
+static void histReset(){
+  hist_n = hist_i = 0; have_pend = false; long_run = 0;
+  est_valid = false;
+  CAP::setBlankUs(0);
+}
+
+static void accept(uint32_t dt, uint32_t now){
+  last_us = now;
+  hist[hist_i] = dt; hist_i = (hist_i + 1) % 3; if (hist_n < 3) hist_n++;
+  st_accepted++;
+  estUpdate(dt);
+  s_pub.publish({now, dt});
+  const uint32_t m = histMedian();
+  CAP::setBlankUs(m ? (uint32_t)(((uint64_t)m * BLANK_FRAC_Q8) >> 8) : 0);
+}
+
+static inline void onEdge(uint32_t now){
+  if (!have_last) { last_us = now; have_last = true; return; }
+  const uint32_t dt = now - last_us;
+  if (dt <= PERIOD_MIN_US) { st_outliers++; return; }               // gai sát cạnh trước
+  if (dt >= PERIOD_MAX_US) { histReset(); last_us = now; return; }  // sau khi dừng máy
+
+  const uint32_t m = histMedian();
+  const uint32_t m_short = m - m / 5;
+  if (have_pend) {
+    // 2 khoảng ngắn liên tiếp đều nhau → rpm thật vừa tăng vọt (vd PWM test đổi rpm)
+    const uint32_t a = pend_us - last_us, b = now - pend_us;
+    if (b < m_short && b + b / 4 >= a && a + a / 4 >= b) {
+      histReset(); last_us = pend_us;
+      accept(b, now);
+      return;
+    }
+  }
+  if (m && dt < m_short) {
+    // ngắn bất thường (động cơ không thể tăng 25% rpm trong 1 chu kỳ): gai lọt blanking
+    pend_us = now; have_pend = true; st_outliers++;
+    return; // giữ mốc last_us, chờ cạnh thật
+  }
+  have_pend = false;
+
+  if (m && dt > m + m / 2) {
+    // mất xung: dời mốc, không đưa vào bộ lọc; kéo dài OUTLIER_RUN lần = giảm tốc thật
+    st_outliers++;
+    if (++long_run < OUTLIER_RUN) { last_us = now; return; }
+    histReset();
+  }
+  long_run = 0;
+  accept(dt, now);
+}
+
+static inline bool estAlive(uint32_t now){
+  return est_valid && (int32_t)(now - last_us) <= (int32_t)TIMEOUT_US;
 }
 
 void RPM::begin(uint8_t pin){
-  pinMode(pin, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(pin), isr, RISING);
+  CAP::begin(pin);
+  last_us = 0; have_last = false;
+  histReset();
+  st_accepted = st_outliers = 0;
+  s_pub.publish({0, 0});
 }
 
-void RPM::setPPR(float ppr){ g_ppr = max(0.1f, ppr); }
-void RPM::setScale(float s){ g_scale = (s<=0?1.0f:s); }
+static void loadUpdate(){
+  const uint32_t w = CAP::widthWord();
+  const uint32_t n = w >> 16;
+  if (n == s_width_seen) return;
+  s_width_seen = n;
+  const uint32_t us = w & 0xFFFF;
+  s_load_q4 = s_load_q4 ? (s_load_q4 - (s_load_q4 >> 2) + (us << 2)) : (us << 4);
+  s_load_us = s_load_q4 >> 4;
+}
+
+void RPM::tick(){
+  uint32_t batch[16];
+  size_t n;
+  while ((n = CAP::drain(batch, sizeof(batch)/sizeof(batch[0]))) > 0) {
+    for (size_t i = 0; i < n; i++) onEdge(batch[i]);
+  }
+  if (s_inj) loadUpdate();
+}
+
+void RPM::setInjector(bool inj){
+  s_inj = inj;
+  CAP::setMode(inj ? CAP::Mode::INJECTOR : CAP::Mode::COIL);
+  s_width_seen = 0; s_load_q4 = 0; s_load_us = 0;
+}
+
+uint16_t RPM::loadUs(){
+  if (!s_inj) return 0;
+  const Published s = s_pub.read();
+  if (s.period_us == 0 || (int32_t)(CAP::nowUs() - s.last_us) > (int32_t)TIMEOUT_US) return 0;
+  return (uint16_t)s_load_us;
+}
+
+uint16_t RPM::loadPermil(){
+  const uint32_t us = loadUs();
+  if (!us) return 0;
+  const uint32_t p = s_pub.read().period_us;
+  const uint32_t pm = us * 1000 / p;
+  return (uint16_t)(pm > 1000 ? 1000 : pm);
+}
+
+uint16_t RPM::filtered(){
+  if (!estAlive(CAP::nowUs())) return 0;
+  return (uint16_t)(est_x_q8 >> 8);
+}
+
+int32_t RPM::accel(){ return estAlive(CAP::nowUs()) ? est_v : 0; }
+
+uint16_t RPM::predict(uint16_t ahead_ms){
+  const uint32_t now = CAP::nowUs();
+  if (!estAlive(now)) return 0;
+  const int64_t h_us = (int64_t)(now - last_us) + (int64_t)ahead_ms * 1000;
+  const int64_t x = (est_x_q8 >> 8) + ((int64_t)est_v * h_us) / 1000000;
+  return (uint16_t)(x < 0 ? 0 : (x > RPM_MAX ? RPM_MAX : x));
+}
+
+void RPM::configure(float ppr, float scale){
+  g_ppr   = (ppr < 0.1f ? 0.1f : ppr);
+  g_scale = (scale <= 0 ? 1.0f : scale);
+  const double k = 60e6 * (double)g_scale / (double)g_ppr + 0.5;
+  g_k = (k >= 4294967295.0) ? 0xFFFFFFFFUL : (uint32_t)k;
+  est_valid = false; // trạng thái ước lượng tính theo hằng số cũ
+}
+void RPM::setPPR(float ppr){ configure(ppr, g_scale); }
+void RPM::setScale(float s){ configure(g_ppr, s); }
+
+bool RPM::snapshot(Snapshot &s, uint8_t n){
+  if (n > HIST_N) n = HIST_N;
+  uint32_t edges[HIST_N + 2];
+  const size_t k = CAP::latest(edges, (size_t)n + 2, &s.seq);
+  s.count = 0;
+  s.last_edge_us = k ? edges[0] : 0;
+  uint32_t newer = s.last_edge_us;
+  for (size_t i = 1; i < k && s.count < n; i++) {
+    const uint32_t dt = newer - edges[i];
+    if (dt <= PERIOD_MIN_US) continue;  // gai nhiễu: bỏ cạnh cũ hơn, giữ cạnh mới
+    if (dt >= PERIOD_MAX_US) break;     // khoảng trống (động cơ dừng): hết lịch sử
+    s.period_us[s.count++] = dt;
+    newer = edges[i];
+  }
+  return s.count > 0;
+}
+
+uint32_t RPM::periodUs(){
+  const Published s = s_pub.read();
+  if (s.period_us == 0) return 0;
+  // timeout if too old (now đọc SAU snapshot nên không thể nhỏ hơn last_us)
+  if ((int32_t)(CAP::nowUs() - s.last_us) > (int32_t)TIMEOUT_US) return 0;
+  return s.period_us;
+}
+void RPM::setEdgeHook(void (*hook)(uint32_t t_us)){ CAP::setEdgeHook(hook); }
+uint32_t RPM::rpmConst(){ return g_k; }
 
 uint16_t RPM::get(){
-  uint32_t p = period_us; if (p==0) return 0;
-  // timeout if too old
-  if ((micros() - last_us) > 500000) return 0; // 0.5s
-  float rpm = 60.0f * 1e6f / (float(p) * g_ppr);
-  rpm *= g_scale;
-  // crude clamp
-  if (rpm<0) rpm=0; if (rpm>20000) rpm=20000;
-  return (uint16_t)rpm;
+  const uint32_t p = periodUs();
+  if (p == 0) return 0;
+  const uint32_t rpm = g_k / p;
+  return (uint16_t)(rpm > RPM_MAX ? RPM_MAX : rpm);
 }
+RPM::Stats RPM::stats(){
+  Stats s;
+  s.accepted = st_accepted;
+  s.blanked  = CAP::blanked();
+  s.outliers = st_outliers;
+  s.overruns = CAP::overruns();
+  return s;
+}
+
 // thêm ở cuối file
-uint16_t RPM_get(){ return RPM::get(); }
\ No newline at end of file
+uint16_t RPM_get(){ return RPM::get(); }
@@ -1,11 +1,45 @@
-
 #pragma once
-#include <Arduino.h>
+#include <stdint.h>
 
 namespace RPM {
+  static constexpr uint8_t HIST_N = 8; // số chu kỳ tối đa trong 1 snapshot
+
+  // Snapshot nhất quán (không xé) của các chu kỳ gần nhất, lấy không cần critical section.
+  struct Snapshot {
+    uint32_t seq;               // số cạnh đã bắt tính đến snapshot
+    uint32_t last_edge_us;      // timestamp cạnh mới nhất
+    uint8_t  count;             // số chu kỳ hợp lệ trong period_us[]
+    uint32_t period_us[HIST_N]; // mới nhất trước
+  };
+
+  // Bộ đếm chất lượng tín hiệu
+  struct Stats {
+    uint32_t accepted;  // chu kỳ được nhận
+    uint32_t blanked;   // cạnh bị cửa sổ blanking loại trong ISR
+    uint32_t outliers;  // chu kỳ lệch so với trung vị bị bỏ (gai / mất xung)
+    uint32_t overruns;  // cạnh mất do tick() rút trễ
+  };
+
   void begin(uint8_t pin);
+  void tick();    // gọi mỗi vòng loop: rút các cạnh đã bắt (theo lô) và cập nhật chu kỳ
+  void setInjector(bool inj);             // nguồn INJECTOR: đo thêm on-time kim phun (tải)
+  void configure(float ppr, float scale); // gộp PPR & scale thành 1 hằng số nguyên, chỉ gọi khi config đổi
   void setPPR(float ppr);
   void setScale(float s);
-  uint16_t get(); // filtered rpm (0 if timeout)
+  uint16_t get(); // rpm từ chu kỳ đã lọc nhiễu (0 if timeout), gọi được từ mọi task
+  uint32_t periodUs(); // chu kỳ giữa 2 cạnh đã lọc (µs, 0 nếu timeout), gọi được từ mọi task
+  uint32_t rpmConst(); // rpm = rpmConst() / chu kỳ µs (đã gộp PPR & scale)
+  // Hook chạy trong ISR capture ở mỗi cạnh hợp lệ (đếm sự kiện đánh lửa), phải nằm trong IRAM
+  void setEdgeHook(void (*hook)(uint32_t t_us));
+  bool snapshot(Snapshot &s, uint8_t n = HIST_N); // chu kỳ thô trong ring, false nếu chưa có
+  Stats stats();
+
+  // Tải động cơ (chỉ nguồn INJECTOR, 0 nếu COIL/timeout), gọi được từ mọi task
+  uint16_t loadUs();      // on-time kim phun đã lọc (µs)
+  uint16_t loadPermil();  // on-time / chu kỳ phun (‰)
+
+  // Bộ ước lượng alpha-beta, cập nhật ở MỖI cạnh trong tick() (chỉ đọc trong ngữ cảnh loop)
+  uint16_t filtered();                // rpm đã lọc (0 nếu timeout)
+  int32_t  accel();                   // dRPM/dt (rpm/s), 0 nếu timeout
+  uint16_t predict(uint16_t ahead_ms); // rpm dự báo tại now + ahead_ms
 }
-#pragma once
@@ -0,0 +1,181 @@
+#include "scope_trace.h"
+#include "edge_ring.h"
+#include "rpm_capture.h"
+
+// 512 cạnh ≈ 1.3 s ở 24000 cạnh/phút (12000 rpm, ppr 2) > PRE + POST
+static EdgeRing<512> s_edges;
+static uint32_t s_tmp[511];            // snapshot latest() (mới trước), chỉ loop dùng
+
+static uint8_t  s_pool[SCOPE::POOL_BYTES];
+static size_t   s_used = 0;            // bản ghi nằm liền nhau, cũ trước
+static uint32_t s_nextId = 1;
+
+// Kho do loop ghi (tick) và task web đọc → khoá ngắn quanh mỗi thao tác
+#ifdef ARDUINO
+static SemaphoreHandle_t s_lock = nullptr;
+struct Guard {
+  Guard(){ if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY); }
+  ~Guard(){ if (s_lock) xSemaphoreGive(s_lock); }
+};
+#else
+struct Guard { Guard(){} };
+#endif
+
+static bool     s_pending = false;
+static uint32_t s_trigUs = 0, s_k = 0;
+static uint16_t s_cutMs = 0, s_rpm = 0;
+
+// ---- mã hoá ----
+static inline uint32_t zigzag(int32_t v){ return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t  unzigzag(uint32_t v){ return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static inline size_t putVar(uint8_t *p, uint32_t v){
+  size_t n = 0;
+  while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+static inline uint32_t getVar(const uint8_t *&p, const uint8_t *end){
+  uint32_t v = 0; uint8_t sh = 0;
+  while (p < end && sh < 35) { const uint8_t b = *p++; v |= (uint32_t)(b & 0x7F) << sh; if (!(b & 0x80)) break; sh += 7; }
+  return v;
+}
+static inline void put16(uint8_t *p, uint16_t v){ p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void put32(uint8_t *p, uint32_t v){ put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+static inline uint16_t get16(const uint8_t *p){ return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t get32(const uint8_t *p){ return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+static inline size_t recLen(const uint8_t *r){ return SCOPE::HEADER_BYTES + get16(r + 22); }
+
+// bỏ bản ghi cũ nhất cho tới khi đủ chỗ
+static bool makeRoom(size_t need){
+  if (need > SCOPE::POOL_BYTES) return false;
+  size_t drop = 0;
+  while (s_used - drop + need > SCOPE::POOL_BYTES) drop += recLen(s_pool + drop);
+  if (drop) { memmove(s_pool, s_pool + drop, s_used - drop); s_used -= drop; }
+  return true;
+}
+
+static const uint8_t* recAt(uint8_t idx){
+  size_t off = 0;
+  for (uint8_t i = 0; off < s_used; i++) {
+    if (i == idx) return s_pool + off;
+    off += recLen(s_pool + off);
+  }
+  return nullptr;
+}
+
+// ---- impl ----
+void SCOPE::begin(){
+#ifdef ARDUINO
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+#endif
+  s_edges.clear(); s_used = 0; s_pending = false;
+}
+
+void IRAM_ATTR SCOPE::onEdge(uint32_t t_us){ s_edges.push(t_us); }
+
+void SCOPE::trigger(uint32_t trig_us, uint16_t cut_ms, uint16_t rpm, uint32_t k_rpm_us){
+  if (s_pending) return;
+  s_trigUs = trig_us; s_cutMs = cut_ms; s_rpm = rpm; s_k = k_rpm_us;
+  s_pending = true;
+}
+
+void SCOPE::tick(){
+  if (!s_pending) return;
+  const uint32_t hi = s_trigUs + (uint32_t)POST_MS * 1000UL;
+  if ((int32_t)(CAP::nowUs() - hi) < 0) return;
+  s_pending = false;
+  const uint32_t lo = s_trigUs - (uint32_t)PRE_MS * 1000UL;
+
+  // latest(): mới trước → lấy các cạnh trong [lo, hi], đảo lại cũ trước khi mã hoá
+  const size_t m = s_edges.latest(s_tmp, sizeof(s_tmp) / sizeof(s_tmp[0]));
+  size_t first = m, last = m; // s_tmp[last..first) nằm trong cửa sổ
+  for (size_t i = 0; i < m; i++) {
+    const uint32_t t = s_tmp[i];
+    if ((int32_t)(t - hi) > 0) continue;
+    if ((int32_t)(t - lo) < 0) break;
+    if (last == m) last = i;
+    first = i + 1;
+  }
+  const uint16_t n = (last == m) ? 0 : (uint16_t)(first - last);
+
+  // mã hoá vào cuối kho (trường hợp xấu nhất 5 byte/cạnh)
+  Guard g;
+  const size_t worst = HEADER_BYTES + 10 + (size_t)n * 5;
+  if (!makeRoom(worst)) return;
+  uint8_t *r = s_pool + s_used;
+  uint8_t *d = r + HEADER_BYTES;
+  size_t len = 0;
+  if (n) {
+    const uint32_t t0 = s_tmp[first - 1];
+    len += putVar(d + len, zigzag((int32_t)(t0 - s_trigUs)));
+    uint32_t prevT = t0, prevP = 0;
+    for (size_t i = first - 1; i-- > last; ) {
+      const uint32_t p = s_tmp[i] - prevT;
+      len += (prevP == 0) ? putVar(d + len, p) : putVar(d + len, zigzag((int32_t)(p - prevP)));
+      prevT = s_tmp[i]; prevP = p;
+    }
+  }
+  r[0] = 'Q'; r[1] = 'S'; r[2] = 1; r[3] = 0;
+  put32(r + 4, s_nextId++); put32(r + 8, s_trigUs); put32(r + 12, s_k);
+  put16(r + 16, s_cutMs); put16(r + 18, s_rpm);
+  put16(r + 20, n); put16(r + 22, (uint16_t)len);
+  s_used += HEADER_BYTES + len;
+}
+
+uint8_t SCOPE::count(){
+  Guard g;
+  uint8_t n = 0;
+  for (size_t off = 0; off < s_used; off += recLen(s_pool + off)) n++;
+  return n;
+}
+
+static bool infoAt(uint8_t idx, SCOPE::Info &o){
+  const uint8_t *r = recAt(idx);
+  if (!r) return false;
+  o.id = get32(r + 4); o.trig_us = get32(r + 8);
+  o.cut_ms = get16(r + 16); o.rpm = get16(r + 18); o.n = get16(r + 20); o.bytes = (uint16_t)recLen(r);
+  return true;
+}
+
+bool SCOPE::info(uint8_t idx, Info &o){ Guard g; return infoAt(idx, o); }
+
+bool SCOPE::findById(uint32_t id, uint8_t &idx){
+  Guard g;
+  Info o;
+  for (uint8_t i = 0; infoAt(i, o); i++) if (o.id == id) { idx = i; return true; }
+  return false;
+}
+
+bool SCOPE::writeBinary(uint8_t idx, Print &out){
+  Guard g;
+  const uint8_t *r = recAt(idx);
+  if (!r) return false;
+  out.write(r, recLen(r));
+  return true;
+}
+
+bool SCOPE::writeCsv(uint8_t idx, Print &out){
+  Guard g;
+  const uint8_t *r = recAt(idx);
+  if (!r) return false;
+  const uint32_t k = get32(r + 12);
+  const uint16_t n = get16(r + 20);
+  const uint8_t *p = r + HEADER_BYTES, *end = p + get16(r + 22);
+  char buf[48];
+  out.print("t_us,period_us,rpm\n");
+  if (!n) return true;
+  int32_t t = unzigzag(getVar(p, end));
+  snprintf(buf, sizeof(buf), "%ld,,\n", (long)t);
+  out.print(buf);
+  uint32_t per = 0;
+  for (uint16_t i = 1; i < n && p < end; i++) {
+    const uint32_t v = getVar(p, end);
+    per = (i == 1) ? v : (uint32_t)((int32_t)per + unzigzag(v));
+    t += (int32_t)per;
+    snprintf(buf, sizeof(buf), "%ld,%lu,%lu\n", (long)t, (unsigned long)per, (unsigned long)(per ? k / per : 0));
+    out.print(buf);
+  }
+  return true;
+}
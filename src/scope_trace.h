@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Scope RPM quanh mỗi lần sang số =====
+// Hook cạnh RPM (ISR) ghi liên tục timestamp vào ring riêng. Mỗi lần QS cắt, trigger() đánh dấu
+// cửa sổ [trig - PRE, trig + POST]; khi cửa sổ đã qua, tick() (loop) lấy các cạnh trong cửa sổ
+// và nén delta vào kho byte (nhiều lần sang số, bỏ lần cũ nhất khi đầy).
+//
+// Định dạng 1 bản ghi (little-endian), header 24 byte rồi dữ liệu:
+//   'Q','S', ver=1, flags=0 | id u32 | trig_us u32 | k_rpm_us u32 (rpm = k / chu kỳ)
+//   cut_ms u16 | rpm u16 | n u16 (số cạnh) | bytes u16 (độ dài dữ liệu)
+//   dữ liệu: varint zigzag(t0 - trig_us), varint chu kỳ đầu, rồi varint zigzag(chu kỳ - chu kỳ trước)
+// Cửa sổ PRE/POST cố định theo hằng số bên dưới.
+namespace SCOPE {
+  static constexpr uint16_t PRE_MS  = 200;
+  static constexpr uint16_t POST_MS = 500;
+  static constexpr size_t   POOL_BYTES = 6144;
+  static constexpr size_t   HEADER_BYTES = 24;
+
+  struct Info { uint32_t id, trig_us; uint16_t cut_ms, rpm, n, bytes; };
+
+  void begin();
+  void onEdge(uint32_t t_us);       // hook cạnh RPM (ISR), IRAM
+  // Gọi khi QS bắt đầu cắt (loop). Bỏ qua nếu cửa sổ trước chưa xong.
+  void trigger(uint32_t trig_us, uint16_t cut_ms, uint16_t rpm, uint32_t k_rpm_us);
+  void tick();                      // loop: nén cửa sổ đã đủ POST
+
+  uint8_t count();                  // số bản ghi trong kho (cũ trước)
+  bool    info(uint8_t idx, Info &out);
+  bool    findById(uint32_t id, uint8_t &idx);
+  // Xuất bản ghi idx: nhị phân nguyên dạng, hoặc CSV "t_us,period_us,rpm" (t tương đối trigger)
+  bool    writeBinary(uint8_t idx, Print &out);
+  bool    writeCsv(uint8_t idx, Print &out);
+}
@@ -0,0 +1,53 @@
+#include "skip_fire.h"
+#include <Arduino.h>
+
+const SKIP::Pattern SKIP::PATTERNS[SKIP::COUNT] = {
+  { 0x00000000u,  0, "solid" },
+  { 0x0000000Du,  5, "1/2>2/3>full" },  // 1,0 | 1,1,0 | liền
+  { 0x00000015u,  6, "1/2x3>full" },    // 1,0,1,0,1,0 | liền
+  { 0x00000009u,  5, "1/3>1/2>full" },  // 1,0,0 | 1,0 | liền
+  { 0x55555555u, 32, "1/2" },           // 1 trên 2 suốt cửa sổ
+};
+
+// Trạng thái phiên: ghi trong ISR (trigger/capture cùng mức ngắt) hoặc loop khi start
+static volatile bool s_active = false;
+static CutLine  s_line = CutLine::IGN;
+static uint32_t s_mask = 0;
+static uint8_t  s_len = 0, s_idx = 0;
+static uint32_t s_end = 0;      // hết cửa sổ cắt
+static uint32_t s_per = 0;      // chu kỳ dự phòng (lúc start)
+static uint32_t s_last = 0;     // cạnh trước (đo chu kỳ thực tế)
+
+void IRAM_ATTR SKIP::start(CutLine line, uint32_t mask, uint8_t len, uint32_t start_us, uint32_t window_us,
+                           uint32_t per_us, uint32_t next_us){
+  s_active = false;
+  if (!per_us || !len) { CUT::requestAt(line, CutPrio::QS, start_us, window_us); return; }
+  s_line = line; s_mask = mask; s_len = len; s_idx = 1;
+  s_end = start_us + window_us; s_per = per_us; s_last = next_us - per_us;
+  if (mask & 1u) CUT::requestAt(line, CutPrio::QS, start_us, (next_us - start_us) + per_us / 2);
+  s_active = true;
+}
+
+void IRAM_ATTR SKIP::onEdge(uint32_t t){
+  if (!s_active) return;
+  const int32_t left = (int32_t)(s_end - t);
+  if (left <= 0) { s_active = false; return; }
+
+  const uint32_t dt = t - s_last;
+  const uint32_t per = (dt < 2 * s_per) ? dt : s_per; // chu kỳ thực tế, bỏ nếu vừa mất cạnh
+  s_last = t;
+
+  const uint8_t i = s_idx++;
+  if (i >= s_len) {  // hết mẫu → cắt liền phần còn lại
+    CUT::requestAt(s_line, CutPrio::QS, t, (uint32_t)left);
+    s_active = false;
+    return;
+  }
+  if ((s_mask >> i) & 1u) {
+    const uint32_t d = per + per / 2;
+    CUT::requestAt(s_line, CutPrio::QS, t, d < (uint32_t)left ? d : (uint32_t)left);
+  }
+}
+
+void SKIP::stop(){ s_active = false; }
+bool SKIP::active(){ return s_active; }
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include "cut_output.h"
+
+// ===== Skip-fire (cắt mềm) =====
+// Mẫu cắt theo TỪNG lần đánh lửa, chạy trong hook ISR capture RPM (không chờ loop):
+// bit i của mask = 1 → cắt lần đánh lửa thứ i kể từ trigger; hết len lần → cắt liền tới hết
+// cửa sổ. Mỗi lần cắt là 1 yêu cầu CUT dài 1.5 chu kỳ tính từ cạnh trước nó: phủ đúng lần
+// đánh lửa kế tiếp rồi tự nhả trước lần sau (mất cạnh thì cũng tự kết thúc).
+// Cần nguồn rpm không bị chính line cắt làm mất cạnh (pickup/ECU/kim phun khi cắt IGN).
+namespace SKIP {
+  struct Pattern { uint32_t mask; uint8_t len; const char *name; };
+
+  static constexpr uint8_t SOLID = 0;   // không dùng mẫu (xung liền)
+  static constexpr uint8_t COUNT = 5;
+  extern const Pattern PATTERNS[COUNT];  // bảng duy nhất trong skip_fire.cpp
+
+  // Bắt đầu phiên: lần đánh lửa đầu (0) dự báo tại next_us. Gọi được trong ISR.
+  // per_us = 0 (không dự báo được) → cắt liền cả cửa sổ.
+  void start(CutLine line, uint32_t mask, uint8_t len, uint32_t start_us, uint32_t window_us,
+             uint32_t per_us, uint32_t next_us);
+  void onEdge(uint32_t t_us);  // gọi từ hook cạnh RPM (ISR), IRAM
+  void stop();
+  bool active();
+}
@@ -1,30 +1,65 @@
 #include "trigger_input.h"
 #include "pins.h"
-static uint8_t gpin; static uint16_t gdeb; static uint32_t last_ms=0; static bool last=false;
-void TRIG::begin(uint8_t pin, uint16_t debounce_ms){ gpin=pin; gdeb=debounce_ms; pinMode(pin, INPUT_PULLUP); }
-bool TRIG::pressed(){ 
-  bool v = (digitalRead(gpin)==LOW); // true = đang nhấn (LOW)
-  uint32_t now=millis(); 
-  
-  if (v != last) { 
-    last = v; 
-    last_ms = now; 
-  }
-  
-  // Trả về true nếu đang nhấn và đã qua thời gian debounce
-  if (v && (now - last_ms) >= gdeb) {
-    return true; 
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <esp_timer.h>
+
+// ISR chạy cả 2 cạnh để biết lần cuối tín hiệu đổi mức:
+//  - cạnh xuống được nhận nếu tín hiệu đã yên >= debounce (nảy lúc nhả không gây trigger)
+//    và đã qua lockout kể từ cạnh được nhận trước;
+//  - mức phải còn LOW lúc vào ISR (gai ngắn đã qua thì bỏ).
+static uint8_t gpin;
+static volatile uint32_t s_lock_us = 0;
+static uint32_t s_last_edge = 0, s_last_accept = 0;
+static bool     s_have = false;
+static TRIG::EdgeHook s_hook = nullptr;
+static volatile uint32_t s_ev_seq = 0, s_ev_us = 0; // cạnh chốt cho loop
+static uint32_t s_taken = 0;
+static volatile uint32_t s_edges = 0, s_bounced = 0;
+
+static void IRAM_ATTR trigIsr(void*){
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  const bool low = !gpio_ll_get_level(&GPIO, (gpio_num_t)gpin);
+  const uint32_t lock = s_lock_us;
+  const bool quiet = !s_have || (now - s_last_edge) >= lock;
+  const bool out   = !s_have || (now - s_last_accept) >= lock;
+  s_last_edge = now;
+  if (!low) { s_have = true; return; }
+  if (!quiet || !out) { s_bounced = s_bounced + 1; s_have = true; return; }
+  s_have = true; s_last_accept = now;
+  s_edges = s_edges + 1;
+  if (s_hook && s_hook(now)) return;
+  s_ev_us = now;
+  __atomic_store_n(&s_ev_seq, s_ev_seq + 1, __ATOMIC_RELEASE);
+}
+
+void TRIG::begin(uint8_t pin, uint16_t debounce_ms){
+  gpin=pin; setDebounce(debounce_ms);
+  pinMode(pin, INPUT_PULLUP);
+  esp_err_t e = gpio_install_isr_service(ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL3);
+  if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) {
+    Serial.printf("[TRIG] gpio_install_isr_service failed: %d\n", (int)e);
   }
-  
-  return false; 
+  gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_ANYEDGE);
+  gpio_isr_handler_add((gpio_num_t)pin, trigIsr, nullptr);
+  gpio_intr_enable((gpio_num_t)pin);
+}
+
+void TRIG::setDebounce(uint16_t ms){ s_lock_us = (uint32_t)ms * 1000UL; }
+void TRIG::setEdgeHook(EdgeHook hook){ s_hook = hook; }
+
+bool TRIG::take(uint32_t *edge_us){
+  const uint32_t seq = __atomic_load_n(&s_ev_seq, __ATOMIC_ACQUIRE);
+  if (seq == s_taken) return false;
+  s_taken = seq;
+  if (edge_us) *edge_us = s_ev_us;
+  return true;
 }
-static uint8_t sPin = 0;
-static bool sLevel = false; // true = đang nhấn (tùy cách bạn định nghĩa)
+bool TRIG::pressed(){ return take(); }
+
 bool TRIG::rawLevel(){ 
   // Đọc trực tiếp từ pin NPN (active-low)
   return digitalRead(gpin) == LOW; // true = đang nhấn (LOW)
 }
-// Active-low theo code hiện tại
-static inline bool shiftPressedRaw() {
-  return digitalRead(PIN_SHIFT_NPN) == LOW;
-}
\ No newline at end of file
+uint32_t TRIG::edges(){ return s_edges; }
+uint32_t TRIG::bounced(){ return s_bounced; }
@@ -1,8 +1,19 @@
 #pragma once
 #include <Arduino.h>
-namespace TRIG { void begin(uint8_t pin, uint16_t debounce_ms); bool pressed();   void tick();
-  bool fell();   // cạnh
-  bool rose();   // cạnh
-  bool rawLevel(); // <-- thêm}
-}
 
+// Cảm biến sang số trên ngắt GPIO: cạnh xuống đầu tiên được nhận ngay (không trễ debounce),
+// debounce là khoảng lockout SAU cạnh. Cạnh được đóng dấu thời gian (µs, cùng timeline esp_timer).
+namespace TRIG {
+  // Gọi trong ISR (phải nằm trong IRAM): trả true nếu đã xử lý cạnh (cut bắt đầu ngay),
+  // false → cạnh được chốt lại để loop xử lý qua take().
+  using EdgeHook = bool (*)(uint32_t edge_us);
+
+  void begin(uint8_t pin, uint16_t debounce_ms);
+  void setDebounce(uint16_t ms);
+  void setEdgeHook(EdgeHook hook);
+  bool take(uint32_t *edge_us = nullptr); // cạnh chưa xử lý (lấy 1 lần)
+  bool pressed();                         // = take(): giữ cho code cũ
+  bool rawLevel();                        // true = đang nhấn (LOW)
+  uint32_t edges();                       // số cạnh được nhận
+  uint32_t bounced();                     // số cạnh bị lockout/kiểm tra mức loại
+}
@@ -4,12 +4,21 @@
 #include <DNSServer.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
+#include <memory>
+#include <algorithm>
 #include "config_store.h"
+#include "json_pool.h"
 #include "log_ring.h"
 #include "pwm_test.h"
 #include "lock_guard.h"
 #include "control_sm.h"
+#include "cut_output.h"
+#include "trigger_input.h"
+#include "rev_limiter.h"
+#include "scope_trace.h"
+#include "persist_log.h"
 #include "ota_manager.h"
+#include "rpm_rmt.h"
 
 #include <Arduino.h>
 #include "FS.h"
@@ -26,6 +35,7 @@ static bool serOn = true; // có thể thêm /api/serial để bật/tắt nếu
 
 // ===================== Globals =====================
 static AsyncWebServer server(80);
+static AsyncEventSource events("/api/events"); // SSE: khung trạng thái đẩy định kỳ
 static DNSServer dns;
 static uint32_t lastHit   = 0;
 static bool     running   = false; // portal is running
@@ -51,99 +61,231 @@ auto getParam = [&](AsyncWebServerRequest* req, const char* key, const char* def
   return def ? String(def) : String();
 };
 
+// ===================== Config JSON cache =====================
+// JSON config chỉ đổi khi CFG::set() → serialize 1 lần cho mỗi CFG::version(), dùng chung cho
+// /api/get, /api/config/get, /api/json/export. ETag lấy từ nội dung (FNV-1a) chứ không từ
+// version, vì version đếm lại từ 1 sau mỗi lần khởi động. Chỉ truy cập trong task async_tcp;
+// response giữ shared_ptr nên bản cũ vẫn sống tới khi gửi xong dù cache đã được thay.
+struct CfgJson { String body; char etag[12]; };
+static std::shared_ptr<const CfgJson> s_cfgJs;
+static uint32_t s_cfgJsVer = 0;
+
+static std::shared_ptr<const CfgJson> cfgJson() {
+  const uint32_t v = CFG::version(); // đọc trước exportJSON: set() chen giữa chỉ gây build lại thừa
+  if (!s_cfgJs || v != s_cfgJsVer) {
+    auto p = std::make_shared<CfgJson>();
+    CFG::exportJSON(p->body, false);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < p->body.length(); i++) { h ^= (uint8_t)p->body[i]; h *= 16777619u; }
+    snprintf(p->etag, sizeof(p->etag), "\"%08lx\"", (unsigned long)h);
+    s_cfgJs = p; s_cfgJsVer = v;
+    SLOGf("[API] config JSON v%lu: %u bytes, etag %s\n", (unsigned long)v, (unsigned)p->body.length(), p->etag);
+  }
+  return s_cfgJs;
+}
+
+// 304 nếu If-None-Match khớp, ngược lại gửi thẳng từ buffer cache (không copy sang String mới).
+// no-cache = trình duyệt được lưu nhưng phải hỏi lại mỗi lần → fetch() tự gửi If-None-Match.
+static void sendCfgJson(AsyncWebServerRequest* req) {
+  std::shared_ptr<const CfgJson> js = cfgJson();
+  const AsyncWebHeader* inm = req->getHeader("If-None-Match");
+  AsyncWebServerResponse* response;
+  if (inm && inm->value() == js->etag) {
+    response = req->beginResponse(304);
+  } else {
+    response = req->beginResponse("application/json", js->body.length(),
+      [js](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+        const size_t n = std::min(maxLen, (size_t)js->body.length() - index);
+        memcpy(buf, js->body.c_str() + index, n);
+        return n;
+      });
+  }
+  response->addHeader("ETag", js->etag);
+  response->addHeader("Cache-Control", "no-cache");
+  req->send(response);
+  lastHit = millis();
+}
+
+// ===================== JSON body cho POST =====================
+// Body được parse 1 lần, thẳng từ chunk của AsyncWebServer, vào JsonDocument cấp phát từ
+// s_jsonPool (vùng tĩnh, không heap):
+//  - 1 chunk (thường gặp): deserializeJson trên chính buffer nhận, không copy
+//  - nhiều chunk: ghép vào 1 khối đầu pool (đúng content-length), parse khi đủ
+// Pool chỉ có 1 chủ: request khác gửi body chen giữa nhận 503; body > JSON_BODY_MAX → 413.
+// Đỉnh pool của mỗi request (body ghép + document) = bộ nhớ dùng thật → /api/status.
+static constexpr size_t JSON_POOL_BYTES = 12288;
+static constexpr size_t JSON_BODY_MAX   = 4096;
+static JsonPool<JSON_POOL_BYTES> s_jsonPool;
+static AsyncWebServerRequest* s_poolOwner = nullptr;
+static char* s_bodyBuf = nullptr;
+struct BodyStats { uint32_t parsed, chunked, rejected; uint16_t last_peak, max_peak; };
+static BodyStats s_body = {};
+
+using JsonBodyFn = void (*)(AsyncWebServerRequest* req, JsonVariantConst doc);
+
+static void releasePool() {
+  s_body.last_peak = (uint16_t)s_jsonPool.peak();
+  if (s_body.last_peak > s_body.max_peak) s_body.max_peak = s_body.last_peak;
+  s_jsonPool.reset(); s_jsonPool.clearPeak();
+  s_poolOwner = nullptr; s_bodyBuf = nullptr;
+}
+
+static void onJsonChunk(const char* tag, JsonBodyFn fn, AsyncWebServerRequest* req,
+                        uint8_t* data, size_t len, size_t index, size_t total) {
+  if (index == 0) {
+    if (s_poolOwner) {
+      s_body.rejected++;
+      SLOGf("[API] %s - busy\n", tag);
+      req->send(503, "application/json", "{\"ok\":false,\"msg\":\"Busy\"}");
+      return;
+    }
+    if (total > JSON_BODY_MAX) {
+      s_body.rejected++;
+      SLOGf("[API] %s - body %u B quá lớn\n", tag, (unsigned)total);
+      req->send(413, "application/json", "{\"ok\":false,\"msg\":\"Body too large\"}");
+      return;
+    }
+    s_poolOwner = req;
+    if (len < total) {
+      s_bodyBuf = (char*)s_jsonPool.allocate(total); // total <= JSON_BODY_MAX < pool: luôn đủ
+      s_body.chunked++;
+      req->onDisconnect([req]() { if (s_poolOwner == req) releasePool(); }); // client bỏ giữa chừng
+    }
+  }
+  if (s_poolOwner != req || index + len > total) return; // đã bị từ chối ở chunk đầu
+
+  const char* src = (const char*)data;
+  if (s_bodyBuf) {
+    memcpy(s_bodyBuf + index, data, len);
+    if (index + len < total) return;
+    src = s_bodyBuf;
+  }
+  {
+    JsonDocument doc(&s_jsonPool);
+    const DeserializationError e = deserializeJson(doc, src, total);
+    if (e) {
+      SLOGf("[API] %s - BAD JSON (%s)\n", tag, e.c_str());
+      req->send(e == DeserializationError::NoMemory ? 413 : 400, "application/json",
+                "{\"ok\":false,\"msg\":\"Invalid JSON\"}");
+    } else {
+      s_body.parsed++;
+      fn(req, doc.as<JsonVariantConst>());
+    }
+  } // doc hủy trước khi trả pool
+  releasePool();
+  lastHit = millis();
+}
+
+// Body handler cho server.on(): fn nhận document đã parse, tự gửi response
+static ArBodyHandlerFunction jsonBody(const char* tag, JsonBodyFn fn) {
+  return [tag, fn](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total) {
+    onJsonChunk(tag, fn, req, data, len, index, total);
+  };
+}
+
+// ===================== Captive-portal probes =====================
+// Điện thoại vừa vào AP gọi liên tục các URL kiểm tra Internet. Thay vì để onNotFound
+// redirect rồi client kéo cả UI về, trả lời bằng khung nhỏ cố định:
+//  - lần đầu của mỗi client (theo IP) trong PROBE_WINDOW_MS: 302 → http://<AP>/, OS hiện
+//    "Đăng nhập mạng" như cũ
+//  - lặp lại trong cửa sổ: 200 body vài chục byte (khác nội dung "online" mong đợi nên vẫn
+//    là captive), không redirect → không tải lại UI
+// Probe không phải người dùng thao tác → không cập nhật lastHit.
+static const char* const PROBE_PATHS[] = {
+  "/generate_204", "/gen_204",                          // Android, Chrome
+  "/hotspot-detect.html", "/library/test/success.html", // Apple
+  "/connecttest.txt", "/ncsi.txt", "/redirect",         // Windows
+  "/canonical.html", "/success.txt",                    // Firefox
+};
+static constexpr uint32_t PROBE_WINDOW_MS = 10000;
+static constexpr size_t   PROBE_CLIENTS   = 8;   // > số station tối đa của softAP (4)
+struct ProbeClient { uint32_t ip; uint32_t t_ms; };
+static ProbeClient s_probeCli[PROBE_CLIENTS];
+static uint32_t s_probeHits = 0, s_probeLimited = 0;
+static char s_portalUrl[32] = "http://192.168.4.1/";
+
+// true nếu IP này đã được redirect trong cửa sổ; không thì ghi nhận (thay slot cũ nhất)
+static bool probeSeenRecently(uint32_t ip, uint32_t now) {
+  ProbeClient* slot = nullptr;
+  for (auto& c : s_probeCli) {
+    if (c.ip == ip) { slot = &c; break; }
+    if (!slot || (now - c.t_ms) > (now - slot->t_ms)) slot = &c;
+  }
+  const bool recent = slot->ip == ip && (now - slot->t_ms) < PROBE_WINDOW_MS;
+  if (!recent) { slot->ip = ip; slot->t_ms = now; }
+  return recent;
+}
+
+static void handleProbe(AsyncWebServerRequest* req) {
+  s_probeHits++;
+  AsyncWebServerResponse* response;
+  if (probeSeenRecently((uint32_t)req->client()->remoteIP(), millis())) {
+    s_probeLimited++;
+    response = req->beginResponse(200, "text/html", "<a href=\"/\">QS portal</a>");
+  } else {
+    response = req->beginResponse(302);
+    response->addHeader("Location", s_portalUrl);
+  }
+  response->addHeader("Cache-Control", "no-store");
+  req->send(response);
+}
+
+// ===================== Static assets (gzip + ETag) =====================
+// tools/web_assets.py (extra_script) nén data/ vào ảnh LittleFS và ghi /assets.map:
+//   url<TAB>path<TAB>mime<TAB>etag<TAB>cache-control
+// Trên FS chỉ có path + ".gz" → AsyncFileResponse tự gửi bản .gz kèm Content-Encoding: gzip.
+// Mỗi dòng thành 1 route đăng ký trước "/" gốc, nên route fallback bên dưới chỉ còn dùng khi
+// ảnh FS cũ (index.html thô, không có map). If-None-Match khớp → 304 không body.
+struct WebAsset { String path, mime, etag, cache; };
+
+static void sendAsset(AsyncWebServerRequest* req, const WebAsset& a) {
+  const AsyncWebHeader* inm = req->getHeader("If-None-Match");
+  AsyncWebServerResponse* response = (inm && inm->value() == a.etag)
+    ? req->beginResponse(304)
+    : req->beginResponse(LittleFS, a.path, a.mime);
+  response->addHeader("ETag", a.etag);
+  response->addHeader("Cache-Control", a.cache);
+  req->send(response);
+  lastHit = millis();
+  if (a.mime == "text/html") holdPortal = true;
+}
+
+static void registerAssets() {
+  File f = LittleFS.open("/assets.map", "r");
+  if (!f) { SLOGln("[FS] /assets.map không có → phục vụ file thô"); return; }
+  unsigned n = 0;
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    String col[5]; int k = 0, from = 0;
+    for (int i = 0; i <= (int)line.length() && k < 5; i++) {
+      if (i == (int)line.length() || line[i] == '\t') { col[k++] = line.substring(from, i); from = i + 1; }
+    }
+    if (k != 5 || col[0].isEmpty()) continue;
+    const WebAsset a{col[1], col[2], col[3], col[4]};
+    server.on(col[0].c_str(), HTTP_GET, [a](AsyncWebServerRequest* req) { sendAsset(req, a); });
+    n++;
+  }
+  SLOGf("[FS] %u route tĩnh gzip từ /assets.map\n", n);
+}
+
 // ===================== REST API =====================
 static void handleAPI() {
   // --------- Config get/set ----------
   server.on("/api/get", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/get");
-    
-    // Tạo response JSON theo format yêu cầu
-    JsonDocument doc;
-    
-    // Lấy config từ CFG
-    String configJson;
-    CFG::exportJSON(configJson, false);
-    
-    // Parse config JSON để thêm trường lock
-    JsonDocument configDoc;
-    deserializeJson(configDoc, configJson);
-    
-    // Tạo response với format mới
-    doc["mode"] = configDoc["mode"];
-    doc["rpm_source"] = configDoc["rpm_source"];
-    doc["ppr"] = configDoc["ppr"];
-    doc["rpm_min"] = configDoc["rpm_min"];
-    doc["manual_kill_ms"] = configDoc["manual_kill_ms"];
-    doc["debounce_shift_ms"] = configDoc["debounce_shift_ms"];
-    doc["holdoff_ms"] = configDoc["holdoff_ms"];
-    doc["cut_output"] = configDoc["cut_output"];
-    doc["backfire_enabled"] = configDoc["backfire_enabled"];
-    doc["backfire_extra_ms"] = configDoc["backfire_extra_ms"];
-    doc["backfire_min_rpm"] = configDoc["backfire_min_rpm"];
-    doc["ap_timeout_s"] = configDoc["ap_timeout_s"];
-    doc["rpm_scale"] = configDoc["rpm_scale"];
-    doc["map"] = configDoc["map"];
-    
-    // Thêm trường lock
-    doc["lock_enabled"] = configDoc["lock_enabled"] | false;
-    doc["lock_cut_sel"] = configDoc["lock_cut_sel"] | "ign";
-    doc["lock_short_ms_max"] = configDoc["lock_short_ms_max"] | 300;
-    doc["lock_long_ms_min"] = configDoc["lock_long_ms_min"] | 600;
-    doc["lock_gap_ms"] = configDoc["lock_gap_ms"] | 400;
-    doc["lock_timeout_s"] = configDoc["lock_timeout_s"] | 30;
-    doc["lock_max_retries"] = configDoc["lock_max_retries"] | 5;
-    doc["lock_code"] = configDoc["lock_code"] | "";
-    
-    // Thêm trường backfire
-    doc["bf_enable"] = configDoc["bf_enable"] | false;
-    doc["bf_ign_only"] = configDoc["bf_ign_only"] | true;
-    doc["bf_mode"] = configDoc["bf_mode"] | 3;
-    doc["bf_rpm_min"] = configDoc["bf_rpm_min"] | 4500;
-    doc["bf_rpm_max"] = configDoc["bf_rpm_max"] | 9000;
-    doc["bf_warmup_s"] = configDoc["bf_warmup_s"] | 120;
-    doc["bf_decel_thresh"] = configDoc["bf_decel_thresh"] | 3000;
-    doc["bf_window_ms"] = configDoc["bf_window_ms"] | 250;
-    doc["bf_burst_count"] = configDoc["bf_burst_count"] | 3;
-    doc["bf_burst_on"] = configDoc["bf_burst_on"] | 25;
-    doc["bf_burst_off"] = configDoc["bf_burst_off"] | 75;
-    doc["bf_refractory_ms"] = configDoc["bf_refractory_ms"] | 1500;
-    
-    String js;
-    serializeJson(doc, js);
-    
-    AsyncWebServerResponse *response = req->beginResponse(200, "application/json", js);
-    response->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
-    req->send(response);
-    lastHit = millis();
+    sendCfgJson(req);
   });
 
   server.on("/api/set", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/set");
-  }, NULL, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    
-    // Parse JSON để kiểm tra applyNow
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, body);
-    
-    if (error) {
-      SLOGln("[API] /api/set - BAD JSON");
-      req->send(400, "application/json", "{\"ok\":false,\"err\":\"Invalid JSON\"}");
-      lastHit = millis();
-      return;
-    }
-    
+  }, NULL, jsonBody("/api/set", [](AsyncWebServerRequest* req, JsonVariantConst doc) {
     // Lấy config từ body: chấp nhận CẢ 2 dạng
     // 1) {"config": { ... }} (dạng mới)
     // 2) { ... }            (dạng cũ/đơn giản từ UI)
-    JsonObject configObj = doc["config"].isNull() ? doc.as<JsonObject>() : doc["config"].as<JsonObject>();
-    
-    // Chuyển config về JSON string để import
-    String configJson;
-    serializeJson(configObj, configJson);
-    
-    // Lưu config
-    bool ok = CFG::importJSON(configJson);
+    JsonVariantConst configObj = doc["config"].isNull() ? doc : doc["config"];
+
+    // Lưu config (import thẳng từ document đã parse)
+    bool ok = CFG::importJSON(configObj);
     
     if (ok) {
       // Kiểm tra có cần áp dụng ngay không
@@ -161,15 +303,19 @@ static void handleAPI() {
     } else {
       req->send(400, "application/json", "{\"ok\":false,\"err\":\"Config import failed\"}");
     }
-    
-    lastHit = millis();
-  });
+  }));
 
   // --------- Logs ----------
+  // ?since=<seq>: chỉ các bản ghi mới, {"items","seq","dropped"}; không tham số: mảng toàn bộ ring
   server.on("/api/log", HTTP_GET, [](AsyncWebServerRequest* req) {
-    SLOGln("[API] GET /api/log");
-    String js; LOGR::readAllToJson(js);
-    AsyncWebServerResponse *response = req->beginResponse(200, "application/json", js);
+    AsyncResponseStream *response = req->beginResponseStream("application/json");
+    if (req->hasParam("since")) {
+      const uint32_t since = strtoul(req->getParam("since")->value().c_str(), nullptr, 10);
+      LOGR::writeSince(*response, since);
+    } else {
+      SLOGln("[API] GET /api/log");
+      LOGR::writeAll(*response);
+    }
     response->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
     req->send(response);
     lastHit = millis();
@@ -205,6 +351,14 @@ static void handleAPI() {
     lastHit = millis();
   });
 
+  // --------- Telemetry push (SSE) ----------
+  events.onConnect([](AsyncEventSourceClient* client) {
+    SLOGf("[API] SSE client (%u)\n", (unsigned)events.count());
+    client->send("hello", "hi", millis(), 1000); // retry 1 s nếu mất kết nối
+    lastHit = millis();
+  });
+  server.addHandler(&events);
+
   // --------- Status & Debug ----------
   server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/status");
@@ -220,6 +374,57 @@ static void handleAPI() {
     doc["holdoff_remain_ms"] = CTRL::getHoldoffRemainMs();
     doc["can_cut"] = CTRL::canCutNow();
     doc["reason"] = CTRL::getCutReason();
+    doc["inj_us"] = RPM::loadUs();
+    doc["inj_duty_permil"] = RPM::loadPermil();
+    const RPM::Stats rs = RPM::stats();
+    doc["rpm_blanked"] = rs.blanked;
+    doc["rpm_outliers"] = rs.outliers;
+    doc["rpm_overruns"] = rs.overruns;
+    const CUT::PulseStats cs = CUT::stats();
+    doc["cut_pulses"] = cs.count;
+    doc["cut_last_us"] = cs.last_act_us;
+    doc["cut_err_last_us"] = (int32_t)(cs.last_act_us - cs.last_req_us);
+    doc["cut_err_min_us"] = cs.err_min_us;
+    doc["cut_err_max_us"] = cs.err_max_us;
+    doc["cut_err_avg_us"] = cs.err_avg_us;
+    doc["cut_merged"] = cs.merged;
+    doc["cut_preempted"] = cs.preempted;
+    doc["cut_rejected"] = cs.rejected;
+    const CTRL::Latency tl = CTRL::getTriggerLatency();
+    doc["trig_lat_last_us"] = tl.last_us;
+    doc["trig_lat_max_us"] = tl.max_us;
+    doc["trig_lat_avg_us"] = tl.avg_us;
+    doc["trig_fast"] = tl.fast;
+    doc["spark_released"] = tl.spark_released;
+    doc["align_last_us"] = tl.align_last_us;
+    doc["align_avg_us"] = tl.align_avg_us;
+    const LIMIT::Stats ls = LIMIT::stats();
+    doc["lim_cuts"] = ls.cuts;
+    doc["lim_peak_rpm"] = ls.peak_rpm;
+    doc["lim_zone"] = (uint8_t)ls.zone;
+    doc["launch"] = ls.launch;
+    doc["lim_blocked"] = ls.blocked;
+    const PLOG::Stats ps = PLOG::stats();
+    doc["plog_ok"] = ps.ok;
+    doc["plog_kBps"] = ps.kBps;
+    doc["plog_queue"] = ps.queue;
+    doc["plog_queue_max"] = ps.queue_max;
+    doc["plog_dropped"] = ps.dropped;
+    doc["plog_deferred"] = ps.deferred;
+    doc["plog_bytes"] = ps.bytes;
+    doc["plog_write_max_us"] = ps.max_write_us;
+    doc["plog_segment"] = ps.segment;
+    doc["body_parsed"] = s_body.parsed;
+    doc["body_chunked"] = s_body.chunked;
+    doc["body_rejected"] = s_body.rejected;
+    doc["body_peak"] = s_body.last_peak;
+    doc["body_peak_max"] = s_body.max_peak;
+    doc["body_pool"] = (uint32_t)JSON_POOL_BYTES;
+    doc["body_pool_fails"] = s_jsonPool.fails();
+    doc["probe_hits"] = s_probeHits;
+    doc["probe_limited"] = s_probeLimited;
+    doc["trig_edges"] = TRIG::edges();
+    doc["trig_bounced"] = TRIG::bounced();
     
     String js;
     serializeJson(doc, js);
@@ -233,22 +438,16 @@ static void handleAPI() {
   // --------- Config API aliases (không phá route cũ) ----------
   server.on("/api/config/get", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/config/get (alias)");
-    String js; CFG::exportJSON(js, false);
-    AsyncWebServerResponse *response = req->beginResponse(200, "application/json", js);
-    response->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
-    req->send(response);
-    lastHit = millis();
+    sendCfgJson(req);
   });
 
   server.on("/api/config/set", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/config/set (alias)");
-  }, NULL, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    bool ok = CFG::importJSON(body);
+  }, NULL, jsonBody("/api/config/set", [](AsyncWebServerRequest* req, JsonVariantConst doc) {
+    bool ok = CFG::importJSON(doc);
     SLOGf("[API] /api/config/set → %s\n", ok ? "OK" : "BAD");
     req->send(ok ? 200 : 400, "text/plain", ok ? "OK" : "BAD");
-    lastHit = millis();
-  });
+  }));
 
   server.on("/api/json/export", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/json/export (alias)");
@@ -256,9 +455,11 @@ static void handleAPI() {
     // Kiểm tra include_secret parameter
     bool includeSecret = req->getParam("include_secret", true) ? 
                         req->getParam("include_secret", true)->value().toInt() : false;
+    if (!includeSecret) { sendCfgJson(req); return; }
     
+    // Bản có mật khẩu: không cache, không ETag
     String js; 
-    CFG::exportJSON(js, includeSecret);
+    CFG::exportJSON(js, true);
     AsyncWebServerResponse *response = req->beginResponse(200, "application/json", js);
     response->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
     req->send(response);
@@ -267,44 +468,60 @@ static void handleAPI() {
 
   server.on("/api/json/import", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/json/import (alias)");
-  }, NULL, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    bool ok = CFG::importJSON(body);
+  }, NULL, jsonBody("/api/json/import", [](AsyncWebServerRequest* req, JsonVariantConst doc) {
+    bool ok = CFG::importJSON(doc);
     SLOGf("[API] /api/json/import → %s\n", ok ? "OK" : "BAD");
     req->send(ok ? 200 : 400, "text/plain", ok ? "OK" : "BAD");
-    lastHit = millis();
-  });
+  }));
 
-  // --------- Logs với pagination và verbose ----------
+  // --------- Logs theo trang: offset = seq bắt đầu, "seq" trả về = offset cho trang sau ----------
   server.on("/api/logs", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/logs");
     
-    // Parse query parameters
-    int offset = req->getParam("offset", true) ? req->getParam("offset", true)->value().toInt() : 0;
-    int limit = req->getParam("limit", true) ? req->getParam("limit", true)->value().toInt() : 100;
-    bool verbose = req->getParam("verbose", true) ? req->getParam("verbose", true)->value().toInt() : 0;
+    const uint32_t offset = req->hasParam("offset") ? strtoul(req->getParam("offset")->value().c_str(), nullptr, 10) : 0;
+    int limit = req->hasParam("limit") ? req->getParam("limit")->value().toInt() : 100;
     
     // Clamp limit
     if (limit > 200) limit = 200;
     if (limit < 1) limit = 1;
     
-    String js; 
-    LOGR::readAllToJson(js);
-    
-    // Tạo response với next_offset
-    JsonDocument doc;
-    doc["items"] = js;
-    doc["next_offset"] = -1;
-    
-    String response;
-    serializeJson(doc, response);
-    
-    AsyncWebServerResponse *resp = req->beginResponse(200, "application/json", response);
+    AsyncResponseStream *resp = req->beginResponseStream("application/json");
+    LOGR::writeSince(*resp, offset, (uint16_t)limit);
     resp->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
     req->send(resp);
     lastHit = millis();
   });
 
+  // --------- Scope RPM quanh mỗi lần sang số ----------
+  server.on("/api/scope/list", HTTP_GET, [](AsyncWebServerRequest* req) {
+    SLOGln("[API] GET /api/scope/list");
+    AsyncResponseStream *resp = req->beginResponseStream("application/json");
+    resp->printf("{\"pre_ms\":%u,\"post_ms\":%u,\"items\":[", SCOPE::PRE_MS, SCOPE::POST_MS);
+    SCOPE::Info in;
+    for (uint8_t i = 0; SCOPE::info(i, in); i++) {
+      resp->printf("%s{\"id\":%lu,\"t\":%lu,\"cut\":%u,\"rpm\":%u,\"n\":%u,\"bytes\":%u}", i ? "," : "",
+                   (unsigned long)in.id, (unsigned long)in.trig_us, in.cut_ms, in.rpm, in.n, in.bytes);
+    }
+    resp->print("]}");
+    resp->addHeader("Cache-Control", "no-store, no-cache, must-revalidate");
+    req->send(resp);
+    lastHit = millis();
+  });
+
+  // ?id=<id>[&fmt=csv]: mặc định nhị phân (định dạng trong scope_trace.h)
+  server.on("/api/scope/get", HTTP_GET, [](AsyncWebServerRequest* req) {
+    const uint32_t id = req->hasParam("id") ? strtoul(req->getParam("id")->value().c_str(), nullptr, 10) : 0;
+    const bool csv = req->hasParam("fmt") && req->getParam("fmt")->value() == "csv";
+    SLOGf("[API] GET /api/scope/get id=%lu fmt=%s\n", (unsigned long)id, csv ? "csv" : "bin");
+    uint8_t idx;
+    if (!SCOPE::findById(id, idx)) { req->send(404, "text/plain", "no such trace"); return; }
+    AsyncResponseStream *resp = req->beginResponseStream(csv ? "text/csv" : "application/octet-stream");
+    if (csv) SCOPE::writeCsv(idx, *resp); else SCOPE::writeBinary(idx, *resp);
+    resp->addHeader("Content-Disposition", String("attachment; filename=\"shift_") + id + (csv ? ".csv\"" : ".bin\""));
+    req->send(resp);
+    lastHit = millis();
+  });
+
   // --------- Wi-Fi AP Status & Control ----------
   server.on("/api/wifi/status", HTTP_GET, [](AsyncWebServerRequest* req) {
     SLOGln("[API] GET /api/wifi/status");
@@ -330,17 +547,7 @@ static void handleAPI() {
 
   server.on("/api/wifi/config", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/wifi/config");
-  }, nullptr, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    JsonDocument d;
-    DeserializationError e = deserializeJson(d, body);
-    
-    if (e) {
-      SLOGln("[API] /api/wifi/config - BAD JSON");
-      req->send(400, "application/json", "{\"ok\":false,\"msg\":\"Invalid JSON\"}");
-      return;
-    }
-    
+  }, nullptr, jsonBody("/api/wifi/config", [](AsyncWebServerRequest* req, JsonVariantConst d) {
     // Chỉ cho phép đổi password và timeout, không cho đổi SSID
     if (d["ssid"].is<String>()) {
       SLOGln("[WEB] /api/wifi/config: SSID change attempted, ignoring");
@@ -389,8 +596,7 @@ static void handleAPI() {
     }
     
     req->send(200, "application/json", "{\"ok\":true,\"msg\":\"Wi-Fi password updated\"}");
-    lastHit = millis();
-  });
+  }));
 
   // --------- Calibrate RPM ----------
   server.on("/api/calib", HTTP_POST, [](AsyncWebServerRequest* req) {
@@ -402,7 +608,9 @@ static void handleAPI() {
     while (millis() - t0 < 1000) { extern uint16_t RPM_get(); sum += RPM_get(); n++; delay(5); }
     float meas = (n ? (float)sum / n : 1.0f);
     auto cfg = CFG::get();
-    cfg.rpm_scale = (meas > 0 ? (float)true_rpm / meas : 1.0f);
+    // meas đã nhân rpm_scale hiện tại (gộp trong RPM::configure) → hiệu chỉnh tương đối
+    const float cur = cfg.rpm_scale > 0 ? cfg.rpm_scale : 1.0f;
+    cfg.rpm_scale = (meas > 0 ? cur * (float)true_rpm / meas : 1.0f);
     CFG::set(cfg);
     req->send(200, "text/plain", "OK");
     lastHit = millis();
@@ -443,7 +651,11 @@ static void handleAPI() {
     lastHit = millis();
   });
 
+  // --------- Captive-portal probes (trước mọi route khác) ----------
+  for (const char* p : PROBE_PATHS) server.on(p, HTTP_GET, handleProbe);
+
   // --------- Root UI (LittleFS + fallback) ----------
+  registerAssets(); // bản gzip (nếu có) phải đăng ký trước route "/" thô
   server.on("/", HTTP_GET, [](AsyncWebServerRequest* req){
     SLOGf("[WEB] GET / from %s\n", req->client()->remoteIP().toString().c_str());
     if (!LittleFS.exists("/index.html")) {
@@ -467,15 +679,11 @@ static void handleAPI() {
   // /api/rpm  → trả rpm hiện tại (JSON)
   server.on("/api/rpm", HTTP_GET, [](AsyncWebServerRequest* req){
     extern uint16_t RPM_get();          // đã dùng trong /api/calib
-    float rpm_raw = (float)RPM_get();
-    auto cfg = CFG::get();
-    float rpm = rpm_raw * (cfg.rpm_scale > 0 ? cfg.rpm_scale : 1.0f);
-
-    // (tuỳ chọn) clamp để tránh giá trị lố
-    if (rpm < 0) rpm = 0;
+    // rpm_scale đã nằm trong hằng số chia của RPM:: (RPM::configure) → không nhân thêm
+    const uint16_t rpm = RPM_get();
 
     // trả JSON rất nhẹ để poll nhanh
-    String js = String("{\"rpm\":") + String((int)rpm) + "}";
+    String js = String("{\"rpm\":") + String(rpm) + "}";
     req->send(200, "application/json", js);
     lastHit = millis();
   });
@@ -519,16 +727,7 @@ static void handleAPI() {
   // POST /api/lock_cmd  body: {"cmd":"lock"} | {"cmd":"unlock","pass":"0101"} | {"cmd":"enable"} | {"cmd":"disable"}
   server.on("/api/lock_cmd", HTTP_POST, [](AsyncWebServerRequest* req){ 
     SLOGln("[API] POST /api/lock_cmd"); 
-  }, nullptr, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t){
-    String body((char*)data, len);
-    JsonDocument d;
-    DeserializationError e = deserializeJson(d, body);
-    if (e) { 
-      SLOGln("[API] /api/lock_cmd - BAD JSON");
-      req->send(400, "application/json", "{\"ok\":false,\"msg\":\"Invalid JSON\"}"); 
-      return; 
-    }
-    
+  }, nullptr, jsonBody("/api/lock_cmd", [](AsyncWebServerRequest* req, JsonVariantConst d) {
     String cmd = d["cmd"] | "";
     SLOGf("[API] /api/lock_cmd - cmd: %s\n", cmd.c_str());
     
@@ -574,22 +773,12 @@ static void handleAPI() {
       SLOGf("[API] /api/lock_cmd - Invalid command: %s\n", cmd.c_str());
       req->send(400, "application/json", "{\"ok\":false,\"msg\":\"Invalid command\"}");
     }
-    lastHit = millis();
-  });
+  }));
 
   // --------- Lock change password endpoint ----------
   server.on("/api/lock_change_pass", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/lock_change_pass");
-  }, nullptr, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    JsonDocument d;
-    DeserializationError e = deserializeJson(d, body);
-    if (e) {
-      SLOGln("[API] /api/lock_change_pass - BAD JSON");
-      req->send(400, "application/json", "{\"ok\":false,\"msg\":\"Invalid JSON\"}");
-      return;
-    }
-    
+  }, nullptr, jsonBody("/api/lock_change_pass", [](AsyncWebServerRequest* req, JsonVariantConst d) {
     String oldPass = d["old"] | "";
     String newPass = d["neo"] | "";
     
@@ -612,22 +801,12 @@ static void handleAPI() {
     
     SLOGln("[API] /api/lock_change_pass - Password changed successfully");
     req->send(200, "application/json", "{\"ok\":true,\"msg\":\"Password changed\"}");
-    lastHit = millis();
-  });
+  }));
 
   // --------- Lock set password endpoint ----------
   server.on("/api/lock_set_pass", HTTP_POST, [](AsyncWebServerRequest* req) {
     SLOGln("[API] POST /api/lock_set_pass");
-  }, nullptr, [](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t) {
-    String body((char*)data, len);
-    JsonDocument d;
-    DeserializationError e = deserializeJson(d, body);
-    if (e) {
-      SLOGln("[API] /api/lock_set_pass - BAD JSON");
-      req->send(400, "application/json", "{\"ok\":false,\"msg\":\"Invalid JSON\"}");
-      return;
-    }
-    
+  }, nullptr, jsonBody("/api/lock_set_pass", [](AsyncWebServerRequest* req, JsonVariantConst d) {
     String newPass = d["pass"] | "";
     
     if (newPass.length() == 0) {
@@ -643,8 +822,7 @@ static void handleAPI() {
     
     SLOGln("[API] /api/lock_set_pass - Password set successfully");
     req->send(200, "application/json", "{\"ok\":true,\"msg\":\"Password set\"}");
-    lastHit = millis();
-  });
+  }));
 
   // Register OTA routes
   OTAHTTP_registerRoutes(server);
@@ -689,17 +867,36 @@ void WEB::beginPortal() {
   SLOGf("[AP] IP  : %s\n", WiFi.softAPIP().toString().c_str());
 
   dns.start(53, "*", WiFi.softAPIP());
+  snprintf(s_portalUrl, sizeof(s_portalUrl), "http://%s/", WiFi.softAPIP().toString().c_str());
   handleAPI();
-  server.onNotFound([](AsyncWebServerRequest* req) { lastHit = millis(); req->redirect("/"); });
+  // URL lạ (thường là host ngoài do DNS "*" trỏ về AP) → địa chỉ tuyệt đối của portal
+  server.onNotFound([](AsyncWebServerRequest* req) { lastHit = millis(); req->redirect(s_portalUrl); });
   server.begin();
 }
 
+// Khung trạng thái gọn, tạo 1 lần mỗi chu kỳ rồi phát cho mọi client SSE
+static void pushTelemetry(const QSConfig& c){
+  static uint32_t t0 = 0;
+  if (!c.tele_ms || events.count() == 0) return;
+  const uint32_t now = millis();
+  if (now - t0 < c.tele_ms) return;
+  t0 = now;
+  lastHit = now; // UI đang mở → không tắt AP
+
+  char buf[128];   // rpm đã gồm rpm_scale (RPM::configure), giống /api/status
+  snprintf(buf, sizeof(buf), "{\"rpm\":%u,\"st\":\"%s\",\"ho\":%u,\"cut\":%u,\"lock\":%u,\"why\":\"%s\"}",
+           (unsigned)CTRL::getCurrentRPM(), CTRL::getCurrentState(), (unsigned)CTRL::getHoldoffRemainMs(),
+           (unsigned)CTRL::getLastCutMs(), LOCK::isLocked() ? 1u : 0u, CTRL::getCutReason());
+  events.send(buf, "st", now);
+}
+
 void WEB::loop() {
   if (!running) return;
   dns.processNextRequest();
+  pushTelemetry(CFG::snapshot());
   if (holdPortal) return; // Giữ AP khi người dùng đang mở UI
 
-  uint16_t tout = CFG::get().ap_timeout_s; // timeout cấu hình trong Web
+  uint16_t tout = CFG::snapshot().ap_timeout_s; // timeout cấu hình trong Web
   if (tout > 0 && (millis() - lastHit) > (uint32_t)tout * 1000UL) {
     server.end(); dns.stop(); WiFi.softAPdisconnect(true);
     running = false;
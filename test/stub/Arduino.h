@@ -0,0 +1,47 @@
+#pragma once
+// Arduino.h thay thế cho [env:native]: chỉ đủ cho các module build được trên host
+// (xem build_src_filter). Đồng hồ millis()/micros() do test điều khiển qua STUB::setUs().
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+using std::min;
+using std::max;
+
+namespace STUB {
+  inline uint32_t& us() { static uint32_t v = 0; return v; }
+  inline void setUs(uint32_t t) { us() = t; }
+}
+inline uint32_t micros() { return STUB::us(); }
+inline uint32_t millis() { return STUB::us() / 1000; }
+inline void delay(uint32_t) {}
+
+template <class T> T constrain(T x, T a, T b) { return x < a ? a : (x > b ? b : x); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int  digitalRead(uint8_t) { return HIGH; }
+
+struct String : std::string {
+  using std::string::string;
+  String() {}
+  String(const std::string& s) : std::string(s) {}
+};
+
+struct Print {
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t* b, size_t n) = 0;
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  virtual ~Print() {}
+};
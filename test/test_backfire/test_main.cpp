@@ -0,0 +1,164 @@
+// BackfireController trên timer cắt mô phỏng: chuỗi nhịp do CUT::play() phát phải đúng số nhịp,
+// đúng độ dài on/off, bắt đầu đúng lúc QS nhả, và không bắn trước khi hết warmup.
+#include <unity.h>
+#include <vector>
+#include "Backfire.h"
+#include "cut_timer.h"
+
+static constexpr uint8_t PIN = 6;
+
+static uint16_t s_rpm;
+static int32_t  s_accel;
+static uint32_t s_t;
+static BackfireController bf;
+
+static uint16_t getRpm() { return s_rpm; }
+static bool     isBusy() { return CUT::isActive(); }
+static bool     play(uint32_t t0, const CUT::Timeline& tl) { return CUT::play(CutLine::IGN, CutPrio::BACKFIRE, t0, tl); }
+static bool     isIgn() { return true; }
+static int32_t  accel() { return s_accel; }
+
+struct Pulse { uint32_t on, off; };  // µs, tương đối so với mốc của run()
+
+// Chạy tới+us, loop gọi tick() mỗi tick_us; ghi lại các xung trên chân IGN
+static std::vector<Pulse> run(uint32_t us, uint32_t tick_us = 1000) {
+  std::vector<Pulse> v;
+  const uint32_t t0 = s_t;
+  bool lvl = CUTTMR::simPin(PIN);
+  if (lvl) v.push_back({0, 0});
+  for (uint32_t d = 0; d < us; d += 100) {
+    s_t += 100;
+    CUTTMR::simAdvance(s_t);
+    if ((s_t - t0) % tick_us == 0) bf.tick(CUT::nowUs());
+    const bool l = CUTTMR::simPin(PIN);
+    if (l && !lvl) v.push_back({s_t - t0, 0});
+    if (!l && lvl && !v.empty()) v.back().off = s_t - t0;
+    lvl = l;
+  }
+  return v;
+}
+
+static BackfireController::Config cfg() {
+  BackfireController::Config c;
+  c.enabled = true; c.ign_only = true;
+  c.mode = BackfireController::BF_SHIFT | BackfireController::BF_OVERRUN;
+  c.rpm_min = 4000; c.rpm_max = 9000;
+  c.warmup_s = 0;
+  c.decel_thresh_rpm_s = 3000;
+  c.window_after_shift_ms = 250;
+  c.burst_count = 3; c.burst_on_ms = 25; c.burst_off_ms = 75;
+  c.refractory_ms = 1500;
+  return c;
+}
+
+void setUp() {
+  CUT::begin(PIN, 7);
+  s_t = 1000; CUTTMR::simAdvance(s_t);
+  s_rpm = 6000; s_accel = 0;
+  bf.begin(cfg(), getRpm, isBusy, play, isIgn, accel);
+  bf.tick(CUT::nowUs());                        // mốc warmup
+}
+void tearDown() {}
+
+void test_overrun_burst_count_and_spacing() {
+  run(10000);
+  s_accel = -5000;
+  const std::vector<Pulse> v = run(500000);
+  TEST_ASSERT_EQUAL_UINT32(3, v.size());
+  for (size_t i = 0; i < v.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(25000, v[i].off - v[i].on);
+    if (i) TEST_ASSERT_EQUAL_UINT32(100000, v[i].on - v[i - 1].on);
+  }
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_FALSE(bf.active());
+}
+
+void test_spacing_independent_of_loop_rate() {
+  // loop chậm (30 ms/tick) chỉ làm trễ lúc quyết định, không làm trôi nhịp
+  s_accel = -5000;
+  const std::vector<Pulse> v = run(600000, 30000);
+  TEST_ASSERT_EQUAL_UINT32(3, v.size());
+  for (size_t i = 0; i < v.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(25000, v[i].off - v[i].on);
+    if (i) TEST_ASSERT_EQUAL_UINT32(100000, v[i].on - v[i - 1].on);
+  }
+}
+
+void test_shift_burst_starts_at_qs_release() {
+  CUT::pulse_us(CutLine::IGN, 50000);           // cut QS 50 ms
+  bf.onShiftCut(CUT::nowUs() + 50000);
+  const std::vector<Pulse> v = run(500000);
+  // nhịp đầu nối liền cut QS (BACKFIRE bắt đầu đúng lúc QS nhả), 2 nhịp sau cách 100 ms
+  TEST_ASSERT_EQUAL_UINT32(3, v.size());
+  TEST_ASSERT_EQUAL_UINT32(75000, v[0].off);
+  TEST_ASSERT_EQUAL_UINT32(150000, v[1].on);
+  TEST_ASSERT_EQUAL_UINT32(250000, v[2].on);
+  TEST_ASSERT_EQUAL_UINT32(275000, v[2].off);
+}
+
+void test_single_pulse_keeps_off_gap() {
+  // burst_count 1, không refractory: chuỗi kế tiếp chỉ được bắt đầu sau OFF của nhịp duy nhất
+  BackfireController::Config c = cfg();
+  c.burst_count = 1; c.refractory_ms = 0;
+  bf.begin(c, getRpm, isBusy, play, isIgn, accel);
+  bf.tick(CUT::nowUs());
+  s_accel = -5000;
+  const std::vector<Pulse> v = run(450000);
+  TEST_ASSERT_EQUAL_UINT32(5, v.size());
+  for (size_t i = 0; i < v.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(25000, v[i].off - v[i].on);
+    if (i) TEST_ASSERT_EQUAL_UINT32(100000, v[i].on - v[i - 1].on);
+  }
+  TEST_ASSERT_TRUE(bf.active());                // 50 ms sau nhịp cuối: vẫn trong OFF
+}
+
+void test_refractory_blocks_second_burst() {
+  s_accel = -5000;
+  TEST_ASSERT_EQUAL_UINT32(3, run(1000000).size());
+  TEST_ASSERT_EQUAL_UINT32(0, run(400000).size());  // vẫn trong 1.5 s
+  TEST_ASSERT_EQUAL_UINT32(3, run(600000).size());
+}
+
+void test_outside_rpm_window_never_fires() {
+  s_accel = -5000; s_rpm = 3000;
+  TEST_ASSERT_EQUAL_UINT32(0, run(300000).size());
+  s_rpm = 9500;
+  TEST_ASSERT_EQUAL_UINT32(0, run(300000).size());
+}
+
+void test_warmup_gates_firing() {
+  BackfireController::Config c = cfg();
+  c.warmup_s = 2;
+  bf.begin(c, getRpm, isBusy, play, isIgn, accel);
+  bf.tick(CUT::nowUs());
+  s_accel = -5000;
+  TEST_ASSERT_EQUAL_UINT32(0, run(1990000, 10000).size());
+  TEST_ASSERT_EQUAL_UINT32(3, run(400000).size());
+}
+
+void test_warmup_clamped_to_max() {
+  // 5000 s × 1e6 tràn uint32: bị giới hạn ở WARMUP_S_MAX thay vì bắn sớm/không bao giờ bắn
+  BackfireController::Config c = cfg();
+  c.warmup_s = 5000;
+  bf.begin(c, getRpm, isBusy, play, isIgn, accel);
+  bf.tick(CUT::nowUs());
+  s_accel = -5000;
+  const uint32_t max_us = (uint32_t)BackfireController::WARMUP_S_MAX * 1000000UL;
+  for (uint32_t e = 0; e + 1000000 < max_us; e += 1000000) {
+    TEST_ASSERT_EQUAL_UINT32(0, run(1000000, 100000).size());
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, run(2000000, 100000).size());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_overrun_burst_count_and_spacing);
+  RUN_TEST(test_spacing_independent_of_loop_rate);
+  RUN_TEST(test_shift_burst_starts_at_qs_release);
+  RUN_TEST(test_single_pulse_keeps_off_gap);
+  RUN_TEST(test_refractory_blocks_second_burst);
+  RUN_TEST(test_outside_rpm_window_never_fires);
+  RUN_TEST(test_warmup_gates_firing);
+  RUN_TEST(test_warmup_clamped_to_max);
+  return UNITY_END();
+}
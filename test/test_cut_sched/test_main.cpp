@@ -0,0 +1,136 @@
+// Bộ lập lịch CUT:: (ưu tiên/gộp/hoãn theo line) trên timer mô phỏng.
+#include <unity.h>
+#include "cut_output.h"
+#include "cut_timer.h"
+
+static uint32_t s_t;
+
+static void adv(uint32_t us, uint32_t step = 100) {
+  for (uint32_t d = 0; d < us; d += step) { s_t += step; CUTTMR::simAdvance(s_t); }
+}
+
+void setUp() { CUT::begin(6, 7); s_t = 1000; CUTTMR::simAdvance(s_t); }
+void tearDown() {}
+
+void test_lines_release_independently() {
+  CUT::pulse_us(CutLine::INJ, 30000);
+  CUT::pulse_us(CutLine::IGN, 5000, CutPrio::BACKFIRE);
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::INJ) && CUT::isActive(CutLine::IGN));
+  adv(6000);
+  TEST_ASSERT_FALSE(CUT::isActive(CutLine::IGN));
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::INJ));
+  adv(25000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+void test_same_prio_merges() {
+  CUT::pulse_us(CutLine::IGN, 10000);
+  adv(5000);
+  CUT::pulse_us(CutLine::IGN, 10000);
+  TEST_ASSERT_EQUAL_UINT32(1, CUT::stats().merged);
+  adv(9000);
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::IGN));
+  adv(1100);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(15000, CUT::stats().last_act_us);
+}
+
+void test_lower_prio_rejected_inside_higher() {
+  CUT::pulse_us(CutLine::IGN, 20000);
+  TEST_ASSERT_FALSE(CUT::request(CutLine::IGN, CutPrio::BACKFIRE, 5000));
+  TEST_ASSERT_EQUAL_UINT32(1, CUT::stats().rejected);
+  adv(21000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+void test_higher_prio_preempts_lower() {
+  CUT::request(CutLine::IGN, CutPrio::BACKFIRE, 50000);
+  adv(5000);
+  CUT::pulse_us(CutLine::IGN, 10000);
+  TEST_ASSERT_EQUAL_UINT32(1, CUT::stats().preempted);
+  adv(9900);
+  TEST_ASSERT_TRUE(CUT::isActive());            // cắt liền qua chỗ chuyển ưu tiên
+  adv(200);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+void test_delayed_requests_are_deferred() {
+  CUT::request(CutLine::IGN, CutPrio::BACKFIRE, 3000, 2000);
+  CUT::request(CutLine::IGN, CutPrio::BACKFIRE, 3000, 8000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  adv(2100); TEST_ASSERT_TRUE(CUT::isActive());
+  adv(3000); TEST_ASSERT_FALSE(CUT::isActive());
+  adv(3000); TEST_ASSERT_TRUE(CUT::isActive());
+  adv(3000); TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(2, CUT::stats().count);
+}
+
+void test_full_queue_evicts_lowest_prio() {
+  for (uint32_t i = 0; i < CUT::QUEUE_N; i++) CUT::request(CutLine::INJ, CutPrio::TEST, 1000, 10000 * (i + 1));
+  TEST_ASSERT_FALSE(CUT::request(CutLine::INJ, CutPrio::TEST, 1000, 100000));
+  TEST_ASSERT_TRUE(CUT::request(CutLine::INJ, CutPrio::QS, 1000, 100000));
+  adv(200000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(CUT::QUEUE_N, CUT::stats().count);
+}
+
+void test_lock_hold_beats_everything() {
+  CUT::set(CutLine::INJ, true);
+  TEST_ASSERT_FALSE(CUT::pulse_us(CutLine::INJ, 1000));
+  adv(100000);
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::INJ));
+  CUT::set(CutLine::INJ, false);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+void test_repeated_set_is_noop() {
+  CUT::set(CutLine::IGN, true);
+  const CUT::PulseStats s0 = CUT::stats();
+  for (int i = 0; i < 1000; i++) { adv(1000, 1000); CUT::set(CutLine::IGN, true); }
+  const CUT::PulseStats s1 = CUT::stats();
+  TEST_ASSERT_EQUAL_UINT32(s0.merged, s1.merged);
+  TEST_ASSERT_EQUAL_UINT32(s0.preempted, s1.preempted);
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::IGN));
+  CUT::set(CutLine::IGN, false);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+// Lock giữ lâu hơn 2^31 µs (~35.8 phút): không được tự nhả khi phép so có dấu đảo chiều
+void test_hold_longer_than_2e31_us() {
+  CUT::set(CutLine::IGN, true);
+  for (uint32_t i = 0; i < 2400; i++) {           // 2400 s ≈ 40 phút, loop gọi set() mỗi bước
+    adv(1000000, 1000000);
+    CUT::set(CutLine::IGN, true);
+    CUT::pulse_us(CutLine::INJ, 100);             // evaluate() chạy lại mỗi bước
+    adv(200, 200);
+    TEST_ASSERT_TRUE(CUT::isActive(CutLine::IGN));
+    TEST_ASSERT_TRUE(CUTTMR::simPin(6));
+  }
+  TEST_ASSERT_FALSE(CUT::pulse_us(CutLine::IGN, 1000)); // vẫn chặn ưu tiên thấp hơn
+  CUT::set(CutLine::IGN, false);
+  TEST_ASSERT_FALSE(CUT::isActive(CutLine::IGN));
+}
+
+void test_wrap_around() {
+  s_t = 0xFFFFF000u; CUTTMR::simAdvance(s_t);
+  CUT::pulse_us(CutLine::IGN, 10000);
+  adv(9000);
+  TEST_ASSERT_TRUE(CUT::isActive());
+  adv(1100);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_release_independently);
+  RUN_TEST(test_same_prio_merges);
+  RUN_TEST(test_lower_prio_rejected_inside_higher);
+  RUN_TEST(test_higher_prio_preempts_lower);
+  RUN_TEST(test_delayed_requests_are_deferred);
+  RUN_TEST(test_full_queue_evicts_lowest_prio);
+  RUN_TEST(test_lock_hold_beats_everything);
+  RUN_TEST(test_repeated_set_is_noop);
+  RUN_TEST(test_hold_longer_than_2e31_us);
+  RUN_TEST(test_wrap_around);
+  return UNITY_END();
+}
@@ -0,0 +1,105 @@
+// CUT:: trên timer mô phỏng (cut_timer_sim.cpp): xung được nhả đúng hẹn bởi callback timer,
+// không cần loop()/tick(), kể cả khi đồng hồ µs tràn.
+#include <unity.h>
+#include "cut_output.h"
+#include "cut_timer.h"
+
+static uint32_t s_t;
+
+// Tiến đồng hồ theo bước step tới t + us (callback chạy đúng thời điểm hẹn, không theo bước)
+static void run(uint32_t us, uint32_t step = 500) {
+  for (uint32_t d = 0; d < us; d += step) { s_t += step; CUTTMR::simAdvance(s_t); }
+}
+
+void setUp() { CUT::begin(6, 7); s_t = 1000; CUTTMR::simAdvance(s_t); }
+void tearDown() {}
+
+void test_pulse_released_by_timer_exact() {
+  TEST_ASSERT_TRUE(CUT::pulse_us(CutLine::IGN, 35000));
+  TEST_ASSERT_TRUE(CUT::isActive(CutLine::IGN));
+  TEST_ASSERT_FALSE(CUT::isActive(CutLine::INJ));
+  TEST_ASSERT_TRUE(CUTTMR::simPin(6));
+  TEST_ASSERT_FALSE(CUTTMR::simPin(7));
+  run(34500);
+  TEST_ASSERT_TRUE(CUT::isActive());
+  run(1000);                                  // không gọi tick(): chỉ timer nhả
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_FALSE(CUTTMR::simPin(6));
+  const CUT::PulseStats s = CUT::stats();
+  TEST_ASSERT_EQUAL_UINT32(1, s.count);
+  TEST_ASSERT_EQUAL_UINT32(35000, s.last_req_us);
+  TEST_ASSERT_EQUAL_UINT32(35000, s.last_act_us);
+  TEST_ASSERT_EQUAL_INT32(0, s.err_max_us);
+}
+
+void test_error_stats_over_many_pulses() {
+  for (uint32_t i = 0; i < 50; i++) {
+    CUT::pulse_us(CutLine::INJ, 1000 + i * 137);
+    run(20000, 333);                           // bước lệch pha với độ dài xung
+  }
+  const CUT::PulseStats s = CUT::stats();
+  TEST_ASSERT_EQUAL_UINT32(50, s.count);
+  TEST_ASSERT_EQUAL_INT32(0, s.err_min_us);
+  TEST_ASSERT_EQUAL_INT32(0, s.err_max_us);
+  TEST_ASSERT_EQUAL_INT32(0, s.err_avg_us);
+  CUT::resetStats();
+  TEST_ASSERT_EQUAL_UINT32(0, CUT::stats().count);
+}
+
+void test_delayed_request_starts_on_time() {
+  CUT::request(CutLine::IGN, CutPrio::QS, 5000, 2000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  run(1500);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  run(1000);
+  TEST_ASSERT_TRUE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(1000 + 2000, CUT::startUs());
+  run(5000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(5000, CUT::stats().last_act_us);
+}
+
+void test_pulses_on_both_lines_are_independent() {
+  CUT::pulse(CutLine::INJ, 50);
+  run(10000);
+  CUT::pulse(CutLine::IGN, 20);
+  TEST_ASSERT_TRUE(CUTTMR::simPin(7));
+  TEST_ASSERT_TRUE(CUTTMR::simPin(6));
+  run(20000);
+  TEST_ASSERT_FALSE(CUTTMR::simPin(6));
+  TEST_ASSERT_TRUE(CUTTMR::simPin(7));
+  run(20000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(2, CUT::stats().count);
+}
+
+void test_pulse_across_micros_wrap() {
+  s_t = 0xFFFFF000u; CUTTMR::simAdvance(s_t);
+  CUT::pulse_us(CutLine::IGN, 10000);
+  run(9000);
+  TEST_ASSERT_TRUE(CUT::isActive());
+  run(2000);
+  TEST_ASSERT_FALSE(CUT::isActive());
+  TEST_ASSERT_EQUAL_UINT32(10000, CUT::stats().last_act_us);
+}
+
+void test_tick_ignores_timer_still_on_time() {
+  CUT::pulse_us(CutLine::IGN, 3000);
+  run(2000);
+  CUT::tick();                                // chưa tới hạn: không làm gì
+  TEST_ASSERT_TRUE(CUT::isActive());
+  run(1000);
+  CUT::tick();
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pulse_released_by_timer_exact);
+  RUN_TEST(test_error_stats_over_many_pulses);
+  RUN_TEST(test_delayed_request_starts_on_time);
+  RUN_TEST(test_pulses_on_both_lines_are_independent);
+  RUN_TEST(test_pulse_across_micros_wrap);
+  RUN_TEST(test_tick_ignores_timer_still_on_time);
+  return UNITY_END();
+}
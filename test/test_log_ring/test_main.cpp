@@ -0,0 +1,146 @@
+// LOGR:: (log_ring.cpp) trên host: layout 6 byte, chi phí push(), khôi phục mốc thời gian từ
+// delta, seq/dropped của writeSince, và reader chạy song song với push không thấy bản ghi rách.
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include "log_ring.h"
+
+struct StrPrint : Print {
+  std::string s;
+  size_t write(const uint8_t* b, size_t n) override { s.append((const char*)b, n); return n; }
+};
+
+struct Item { uint32_t t, rpm, cut, s; };
+
+static std::vector<Item> parse(const std::string& js) {
+  std::vector<Item> v;
+  for (size_t p = js.find("{\"t\":"); p != std::string::npos; p = js.find("{\"t\":", p + 1)) {
+    Item it{};
+    unsigned long t = 0, s = 0; unsigned rpm = 0, cut = 0;
+    sscanf(js.c_str() + p, "{\"t\":%lu,\"rpm\":%u,\"cut\":%u", &t, &rpm, &cut);
+    const size_t q = js.find("\"s\":", p);
+    if (q != std::string::npos && q < js.find('}', p)) sscanf(js.c_str() + q, "\"s\":%lu", &s);
+    it.t = (uint32_t)t; it.rpm = rpm; it.cut = cut; it.s = (uint32_t)s;
+    v.push_back(it);
+  }
+  return v;
+}
+
+static uint32_t field(const std::string& js, const char* key) {
+  const size_t p = js.find(key);
+  unsigned long v = 0;
+  if (p != std::string::npos) sscanf(js.c_str() + p + strlen(key), "%lu", &v);
+  return (uint32_t)v;
+}
+
+// rpm và cut suy ra từ cùng i: bản ghi rách (trộn 2 lần push) sẽ lệch cặp này
+static LogItem item(uint32_t i, uint32_t ts) {
+  LogItem it{};
+  it.ts_ms = ts; it.rpm = (uint16_t)(i & 0xFFFF); it.cut_ms = (uint16_t)((i * 7) & 0xFF);
+  it.out = LogOut::IGN; it.why = LogWhy::SHIFT;
+  return it;
+}
+
+void setUp() { LOGR::begin(); }
+void tearDown() {}
+
+void test_layout_and_capacity() {
+  TEST_ASSERT_EQUAL_UINT32(6, sizeof(LogRec));
+  TEST_ASSERT_LESS_OR_EQUAL(64 * 24, LOGR::CAPACITY * sizeof(LogRec));
+  TEST_ASSERT_GREATER_OR_EQUAL(256, LOGR::CAPACITY);
+}
+
+void test_push_cost() {
+  const uint32_t N = 10000000;
+  LogItem it = item(0, 0);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; i++) { it.ts_ms = i * 3; it.rpm = (uint16_t)i; LOGR::push(it); }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  printf("  push(): %.1f ns (host)\n", ns);
+  TEST_ASSERT_EQUAL_UINT32(N, LOGR::seq());
+  TEST_ASSERT_TRUE(ns < 200);
+}
+
+void test_timestamps_round_trip() {
+  // khoảng cách 3 ms .. 5000 s: sai số lượng tử không cộng dồn
+  std::vector<uint32_t> ts;
+  uint32_t t = 1000;
+  const uint32_t gaps[] = {3, 250, 70000, 5000000, 17, 1200000, 65535, 65536, 9};
+  for (uint32_t i = 0; i < 200; i++) {
+    t += gaps[i % (sizeof(gaps) / sizeof(gaps[0]))];
+    ts.push_back(t);
+    LOGR::push(item(i, t));
+  }
+  StrPrint out;
+  TEST_ASSERT_EQUAL_UINT32(200, LOGR::writeAll(out));
+  const std::vector<Item> v = parse(out.s);
+  TEST_ASSERT_EQUAL_UINT32(200, v.size());
+  uint32_t worst = 0;
+  for (size_t i = 0; i < v.size(); i++) {
+    const uint32_t e = v[i].t > ts[i] ? v[i].t - ts[i] : ts[i] - v[i].t;
+    if (e > worst) worst = e;
+    TEST_ASSERT_EQUAL_UINT32(i, v[i].rpm);
+  }
+  TEST_ASSERT_EQUAL_UINT32(ts.back(), v.back().t);   // mốc mới nhất tuyệt đối
+  TEST_ASSERT_LESS_OR_EQUAL(4096, worst);
+}
+
+void test_since_and_dropped() {
+  for (uint32_t i = 0; i < 10; i++) LOGR::push(item(i, 100 + i));
+  StrPrint a;
+  TEST_ASSERT_EQUAL_UINT32(4, LOGR::writeSince(a, 6));
+  TEST_ASSERT_EQUAL_UINT32(10, field(a.s, "\"seq\":"));
+  TEST_ASSERT_EQUAL_UINT32(6, parse(a.s).front().s);
+
+  for (uint32_t i = 10; i < 10 + LOGR::CAPACITY + 20; i++) LOGR::push(item(i, 100 + i));
+  StrPrint b;
+  LOGR::writeSince(b, 10, 8);
+  TEST_ASSERT_EQUAL_UINT32(20, field(b.s, "\"dropped\":"));   // 10..29 đã bị ghi đè
+  TEST_ASSERT_EQUAL_UINT32(30, parse(b.s).front().s);
+  TEST_ASSERT_EQUAL_UINT32(38, field(b.s, "\"seq\":"));
+
+  LOGR::clear();
+  StrPrint c;
+  TEST_ASSERT_EQUAL_UINT32(0, LOGR::writeSince(c, 0));
+  TEST_ASSERT_EQUAL_UINT32(LOGR::seq(), field(c.s, "\"seq\":"));
+}
+
+void test_concurrent_reader_sees_no_torn_records() {
+  std::atomic<bool> stop{false};
+  std::thread w([&] {
+    uint32_t i = 0;
+    while (!stop.load(std::memory_order_relaxed)) { LOGR::push(item(i, i)); i++; }
+  });
+  uint32_t since = 0, reads = 0, items = 0, empty = 0, bad = 0;
+  const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < until) {
+    StrPrint out;
+    const size_t n = LOGR::writeSince(out, since, 64);
+    const uint32_t next = field(out.s, "\"seq\":");
+    if (!n) { empty++; TEST_ASSERT_EQUAL_UINT32(since, next); }
+    for (const Item& it : parse(out.s)) {
+      if (it.rpm != (it.s & 0xFFFF) || it.cut != ((it.s * 7) & 0xFF)) bad++;
+    }
+    items += (uint32_t)n; reads++;
+    since = next;
+  }
+  stop = true;
+  w.join();
+  printf("  %u lần đọc, %u bản ghi, %u lần rỗng, %u rách\n", (unsigned)reads, (unsigned)items, (unsigned)empty, (unsigned)bad);
+  TEST_ASSERT_EQUAL_UINT32(0, bad);
+  TEST_ASSERT_GREATER_THAN(0, items);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_layout_and_capacity);
+  RUN_TEST(test_push_cost);
+  RUN_TEST(test_timestamps_round_trip);
+  RUN_TEST(test_since_and_dropped);
+  RUN_TEST(test_concurrent_reader_sees_no_torn_records);
+  return UNITY_END();
+}
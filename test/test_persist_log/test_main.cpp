@@ -0,0 +1,243 @@
+// PLOG:: trên backend host (persist_log_io_host.cpp, thư mục tạm thay LittleFS): gom bản ghi
+// vào trang 4096 byte, chuyển segment khi đủ 64 KB, chỉ giữ SEG_MAX segment mới nhất, không ghi
+// flash khi đang có xung cắt hẹn giờ, và không xung nào bắt đầu trong lúc ghi (timer cắt mô phỏng).
+#include <unity.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "persist_log.h"
+#include "persist_log_io.h"
+#include "cut_output.h"
+#include "cut_timer.h"
+
+static const char *const ROOT = "/tmp/qs_plog_test";
+static constexpr uint16_t PER_PAGE = (PLOG::PAGE - 16) / sizeof(PLOG::Rec);
+static constexpr uint32_t PAGES_PER_SEG = PLOG::SEG_BYTES / PLOG::PAGE;
+
+static std::string segFile(uint32_t idx) {
+  char b[64]; snprintf(b, sizeof(b), "%s/plog/s%05lu.bin", ROOT, (unsigned long)idx); return b;
+}
+
+static std::vector<uint32_t> listSegs() {
+  std::vector<uint32_t> v;
+  DIR *d = opendir((std::string(ROOT) + "/plog").c_str());
+  if (!d) return v;
+  while (dirent *e = readdir(d)) {
+    unsigned long idx;
+    if (sscanf(e->d_name, "s%5lu.bin", &idx) == 1) v.push_back((uint32_t)idx);
+  }
+  closedir(d);
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+static std::vector<uint8_t> readFile(uint32_t idx) {
+  std::vector<uint8_t> v;
+  FILE *f = fopen(segFile(idx).c_str(), "rb");
+  if (!f) return v;
+  uint8_t b[4096]; size_t n;
+  while ((n = fread(b, 1, sizeof(b), f)) > 0) v.insert(v.end(), b, b + n);
+  fclose(f);
+  return v;
+}
+
+static void touchSeg(uint32_t idx) { FILE *f = fopen(segFile(idx).c_str(), "wb"); if (f) fclose(f); }
+
+// chờ worker ghi hết các trang đã niêm phong
+static void drain() {
+  for (int i = 0; i < 2000 && PLOG::stats().queue; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  TEST_ASSERT_EQUAL_UINT8(0, PLOG::stats().queue);
+}
+
+static void pushN(uint32_t n, uint32_t rpm0 = 0) {
+  for (uint32_t i = 0; i < n; i++) {
+    PLOG::Rec r{}; r.ts_ms = 1000 + i; r.rpm = (uint16_t)(rpm0 + i); r.flags = (uint8_t)PLOG::Kind::TELEM;
+    PLOG::push(r);
+    if (i % 500 == 499) drain();   // không để cả 2 trang cùng chờ ghi
+  }
+  drain();
+}
+
+void setUp() {
+  setenv("PLOG_HOST_ROOT", ROOT, 1);
+  PLOGIO::mount("/plog");
+  for (uint32_t idx : listSegs()) unlink(segFile(idx).c_str());
+  STUB::setUs(5000000);
+}
+void tearDown() { PLOGIO::stopWorker(); }
+
+void test_page_packing() {
+  PLOG::begin();                               // bản ghi BOOT là bản đầu tiên
+  pushN(PER_PAGE - 1, 100);                    // đủ 1 trang → niêm phong ngay
+  std::vector<uint8_t> f = readFile(0);
+  TEST_ASSERT_EQUAL_UINT32(PLOG::PAGE, f.size());
+  TEST_ASSERT_EQUAL_INT(0, memcmp(f.data(), "QSPL", 4));
+  uint32_t seq; uint16_t n, ver; uint32_t ts0;
+  memcpy(&seq, &f[4], 4); memcpy(&n, &f[8], 2); memcpy(&ver, &f[10], 2); memcpy(&ts0, &f[12], 4);
+  TEST_ASSERT_EQUAL_UINT32(0, seq);
+  TEST_ASSERT_EQUAL_UINT(PER_PAGE, n);
+  TEST_ASSERT_EQUAL_UINT(1, ver);
+  TEST_ASSERT_EQUAL_UINT32(5000, ts0);
+  PLOG::Rec r;
+  memcpy(&r, &f[16], 8);
+  TEST_ASSERT_EQUAL_UINT8((uint8_t)PLOG::Kind::BOOT, r.flags);
+  memcpy(&r, &f[16 + 8 * (PER_PAGE - 1)], 8);
+  TEST_ASSERT_EQUAL_UINT(100 + PER_PAGE - 2, r.rpm);
+
+  // trang chưa đầy: flush() → tick() niêm phong, phần còn lại là 0xFF
+  pushN(3, 7000);
+  PLOG::flush(); PLOG::tick(0);
+  drain();
+  f = readFile(0);
+  TEST_ASSERT_EQUAL_UINT32(2 * PLOG::PAGE, f.size());
+  const uint8_t *p = &f[PLOG::PAGE];
+  memcpy(&seq, p + 4, 4); memcpy(&n, p + 8, 2);
+  TEST_ASSERT_EQUAL_UINT32(1, seq);
+  TEST_ASSERT_EQUAL_UINT(3, n);
+  memcpy(&r, p + 16 + 16, 8);
+  TEST_ASSERT_EQUAL_UINT(7002, r.rpm);
+  for (size_t i = 16 + 3 * 8; i < PLOG::PAGE; i++) if (p[i] != 0xFF) TEST_FAIL_MESSAGE("padding != 0xFF");
+  TEST_ASSERT_EQUAL_UINT32(0, PLOG::stats().dropped);
+}
+
+void test_segment_rollover() {
+  PLOG::begin();
+  pushN((PAGES_PER_SEG + 1) * PER_PAGE - 1);
+  TEST_ASSERT_EQUAL_UINT32(PLOG::SEG_BYTES, readFile(0).size());
+  const std::vector<uint8_t> f = readFile(1);
+  TEST_ASSERT_EQUAL_UINT32(PLOG::PAGE, f.size());
+  uint32_t seq; memcpy(&seq, &f[4], 4);
+  TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEG, seq);  // seq nối tiếp qua segment
+  TEST_ASSERT_EQUAL_UINT32(1, PLOG::stats().segment);
+}
+
+void test_begin_prunes_old_segments() {
+  for (uint32_t i = 0; i < 12; i++) touchSeg(i);
+  PLOG::begin();                               // segment mới = 12, giữ 5..11 + 12
+  TEST_ASSERT_EQUAL_UINT32(12, PLOG::stats().segment);
+  std::vector<uint32_t> v = listSegs();
+  TEST_ASSERT_EQUAL_UINT32(PLOG::SEG_MAX - 1, v.size());
+  TEST_ASSERT_EQUAL_UINT32(12 - PLOG::SEG_MAX + 1, v.front());
+  pushN(PER_PAGE - 1);
+  v = listSegs();
+  TEST_ASSERT_EQUAL_UINT32(PLOG::SEG_MAX, v.size());
+  TEST_ASSERT_EQUAL_UINT32(12, v.back());
+}
+
+void test_short_sessions_stay_bounded() {
+  // mỗi lần khởi động chỉ ghi 1 trang, không segment nào đầy
+  for (uint32_t boot = 0; boot < 3 * PLOG::SEG_MAX; boot++) {
+    PLOG::begin();
+    PLOG::flush(); PLOG::tick(0);
+    drain();
+    PLOGIO::stopWorker();
+    TEST_ASSERT_LESS_OR_EQUAL(PLOG::SEG_MAX, listSegs().size());
+  }
+  const std::vector<uint32_t> v = listSegs();
+  TEST_ASSERT_EQUAL_UINT32(PLOG::SEG_MAX, v.size());
+  TEST_ASSERT_EQUAL_UINT32(3 * PLOG::SEG_MAX - 1, v.back());
+}
+
+void test_rollover_keeps_seg_max() {
+  for (uint32_t i = 0; i < 4; i++) touchSeg(i);
+  touchSeg(6);
+  PLOG::begin();                               // segment 7: 0..6 đều còn trong SEG_MAX
+  TEST_ASSERT_EQUAL_UINT32(5, listSegs().size());
+  pushN((PAGES_PER_SEG * 2 + 1) * PER_PAGE - 1); // 7 đầy, 8 đầy, sang 9 → xoá mọi chỉ số <= 1
+  const std::vector<uint32_t> v = listSegs();
+  TEST_ASSERT_EQUAL_UINT32(2, v.front());
+  TEST_ASSERT_EQUAL_UINT32(9, v.back());
+  TEST_ASSERT_EQUAL_UINT32(6, v.size());       // 2, 3, 6, 7, 8, 9
+}
+
+void test_write_waits_for_cut_release() {
+  CUT::begin(6, 7);
+  CUTTMR::simAdvance(1000);
+  PLOG::begin();
+  CUT::pulse_us(CutLine::IGN, 40000);
+  PLOG::flush(); PLOG::tick(0);                // trang BOOT niêm phong giữa xung
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  TEST_ASSERT_EQUAL_UINT8(1, PLOG::stats().queue);
+  TEST_ASSERT_EQUAL_UINT32(0, readFile(0).size());
+  TEST_ASSERT_GREATER_THAN(0, PLOG::stats().deferred);
+  PLOG::tick(0);                               // xung chưa nhả: vẫn hoãn
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  TEST_ASSERT_EQUAL_UINT32(0, readFile(0).size());
+
+  CUTTMR::simAdvance(1000 + 40000);
+  TEST_ASSERT_FALSE(CUT::pending());
+  PLOG::tick(0);                               // nhả xong → đánh thức task ghi
+  drain();
+  TEST_ASSERT_EQUAL_UINT32(PLOG::PAGE, readFile(0).size());
+}
+
+void test_cut_during_slow_write_keeps_release_time() {
+  // ghi 1 trang mất 40 ms: xung yêu cầu giữa lúc ghi bị từ chối (bên gọi thử lại), xung bắt
+  // đầu sau khi ghi xong nhả đúng hẹn — không xung nào chạy trong lúc flash bận
+  CUT::begin(6, 7);
+  uint32_t t = 1000;
+  CUTTMR::simAdvance(t);
+  PLOGIO::simWriteDelayUs(40000);
+  PLOG::begin();
+  PLOG::flush(); PLOG::tick(0);
+  for (int i = 0; i < 1000 && !CUT::flashLocked(); i++) std::this_thread::sleep_for(std::chrono::microseconds(100));
+  TEST_ASSERT_TRUE(CUT::flashLocked());
+
+  const uint32_t rej0 = CUT::stats().rejected;
+  TEST_ASSERT_FALSE(CUT::pulse_us(CutLine::IGN, 20000));
+  TEST_ASSERT_FALSE(CUTTMR::simPin(6));
+  TEST_ASSERT_FALSE(CUT::pending());
+  TEST_ASSERT_EQUAL_UINT32(rej0 + 1, CUT::stats().rejected);
+
+  uint32_t tries = 1;                          // như CTRL ở ARMED: thử lại mỗi tick loop (1 ms)
+  while (!CUT::pulse_us(CutLine::IGN, 20000)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    t += 1000; CUTTMR::simAdvance(t);
+    tries++;
+  }
+  TEST_ASSERT_GREATER_THAN(1, tries);
+  TEST_ASSERT_FALSE(CUT::flashLocked());
+  TEST_ASSERT_GREATER_OR_EQUAL(40000, PLOG::stats().last_write_us);
+  const uint32_t t0 = CUT::nowUs();
+  TEST_ASSERT_TRUE(CUTTMR::simPin(6));
+  CUTTMR::simAdvance(t0 + 19999);
+  TEST_ASSERT_TRUE(CUTTMR::simPin(6));
+  CUTTMR::simAdvance(t0 + 20000);
+  TEST_ASSERT_FALSE(CUTTMR::simPin(6));
+  TEST_ASSERT_EQUAL_UINT32(20000, CUT::stats().last_act_us);
+  PLOGIO::simWriteDelayUs(0);
+}
+
+void test_reserved_window_holds_write() {
+  // cửa sổ QS đã reserve() (vd. giữa 2 bước skip-fire, không có sự kiện hẹn giờ) vẫn chặn ghi
+  CUT::begin(6, 7);
+  CUTTMR::simAdvance(1000);
+  PLOG::begin();
+  CUT::reserve(1000 + 30000);
+  TEST_ASSERT_TRUE(CUT::pending());
+  PLOG::flush(); PLOG::tick(0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  TEST_ASSERT_EQUAL_UINT32(0, readFile(0).size());
+  CUTTMR::simAdvance(1000 + 30000);
+  TEST_ASSERT_FALSE(CUT::pending());
+  PLOG::tick(0);
+  drain();
+  TEST_ASSERT_EQUAL_UINT32(PLOG::PAGE, readFile(0).size());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_page_packing);
+  RUN_TEST(test_segment_rollover);
+  RUN_TEST(test_begin_prunes_old_segments);
+  RUN_TEST(test_short_sessions_stay_bounded);
+  RUN_TEST(test_rollover_keeps_seg_max);
+  RUN_TEST(test_write_waits_for_cut_release);
+  RUN_TEST(test_cut_during_slow_write_keeps_release_time);
+  RUN_TEST(test_reserved_window_holds_write);
+  return UNITY_END();
+}
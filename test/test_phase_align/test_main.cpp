@@ -0,0 +1,106 @@
+// Căn pha điểm bắt đầu cắt (phase_align.h) trên mô hình động cơ: 1 lần đánh lửa/vòng, jitter
+// ±20 µs, rpm cố định hoặc tăng đều. Mỗi trigger ngẫu nhiên cắt 50 ms qua CUT:: (timer mô
+// phỏng): line IGN bắt đầu theo PHASE, line INJ bắt đầu ngay → đếm số lần đánh lửa rơi vào
+// lúc chân đang cắt.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "phase_align.h"
+#include "cut_output.h"
+#include "cut_timer.h"
+
+static constexpr uint8_t PIN_A = 6, PIN_I = 7; // IGN = căn pha, INJ = bắt đầu ngay
+static constexpr uint32_t CUT_US = 50000;
+
+struct Spread { double mean, sd; int lo, hi; double lat; };
+
+static void model(double r0, double acc, Spread& al, Spread& im) {
+  std::vector<uint32_t> sp;
+  double t = 0, rpm = r0;
+  while (t < 3e6) {
+    sp.push_back((uint32_t)(t + (rand() % 41 - 20)));
+    rpm = r0 + acc * t / 1e6; if (rpm > 13000) rpm = 13000;
+    t += 60e6 / rpm;
+  }
+  const int N = 1000;
+  double s[2] = {0, 0}, q[2] = {0, 0}, lat[2] = {0, 0};
+  int lo[2] = {99, 99}, hi[2] = {0, 0};
+  for (int k = 0; k < N; k++) {
+    const uint32_t trig = 1000000 + rand() % 100000;
+    size_t i = 1; while (sp[i + 1] <= trig) i++;
+    const uint32_t per = sp[i] - sp[i - 1];
+    CUT::begin(PIN_A, PIN_I);
+    CUTTMR::simAdvance(trig);
+    uint32_t next = 0;
+    const bool pred = PHASE::predictNext(sp[i], trig, per, next);
+    CUT::requestAt(CutLine::IGN, CutPrio::QS, PHASE::startAt(trig, pred, next), CUT_US);
+    CUT::requestAt(CutLine::INJ, CutPrio::QS, trig, CUT_US);
+    int c[2] = {0, 0}; uint32_t first[2] = {0, 0};
+    for (size_t j = i + 1; sp[j] < trig + 2 * CUT_US; j++) {
+      CUTTMR::simAdvance(sp[j]);
+      const bool cut[2] = {CUTTMR::simPin(PIN_A), CUTTMR::simPin(PIN_I)};
+      for (int l = 0; l < 2; l++) if (cut[l] && !c[l]++) first[l] = sp[j] - trig;
+    }
+    for (int l = 0; l < 2; l++) {
+      s[l] += c[l]; q[l] += c[l] * c[l]; lat[l] += first[l];
+      if (c[l] < lo[l]) lo[l] = c[l];
+      if (c[l] > hi[l]) hi[l] = c[l];
+    }
+  }
+  Spread* out[2] = {&al, &im};
+  for (int l = 0; l < 2; l++) {
+    out[l]->mean = s[l] / N; out[l]->sd = sqrt(q[l] / N - out[l]->mean * out[l]->mean);
+    out[l]->lo = lo[l]; out[l]->hi = hi[l]; out[l]->lat = lat[l] / N;
+  }
+}
+
+void setUp() { srand(1); }
+void tearDown() {}
+
+static void check(double r0, double acc) {
+  Spread al, im;
+  model(r0, acc, al, im);
+  printf("  %5.0f rpm +%4.0f rpm/s: ngay %.2f sd %.2f [%d..%d] trễ %.0f us | căn pha %.2f sd %.2f [%d..%d] trễ %.0f us\n",
+         r0, acc, im.mean, im.sd, im.lo, im.hi, im.lat, al.mean, al.sd, al.lo, al.hi, al.lat);
+  TEST_ASSERT_TRUE(al.sd < 0.15);               // cùng 1 xung ms → cùng số lần bị cắt
+  TEST_ASSERT_TRUE(al.sd < im.sd / 2);
+  TEST_ASSERT_TRUE(al.hi - al.lo <= 1);
+  TEST_ASSERT_TRUE(al.lat < im.lat + 60);       // lần đánh lửa bị cắt đầu tiên không trễ hơn
+}
+
+void test_steady_4000() { check(4000, 0); }
+void test_steady_7000() { check(7000, 0); }
+void test_steady_11000() { check(11000, 0); }
+void test_accel_4000() { check(4000, 8000); }
+void test_accel_7000() { check(7000, 8000); }
+
+void test_no_prediction_when_edges_stop() {
+  uint32_t next = 0;
+  TEST_ASSERT_FALSE(PHASE::predictNext(1000, 1000 + 25000, 10000, next));
+  TEST_ASSERT_FALSE(PHASE::predictNext(1000, 2000, 0, next));
+  TEST_ASSERT_EQUAL_UINT32(5000, PHASE::startAt(5000, false, 0));
+  TEST_ASSERT_TRUE(PHASE::predictNext(1000, 1000 + 15000, 10000, next));
+  TEST_ASSERT_EQUAL_UINT32(21000, next);
+  TEST_ASSERT_EQUAL_UINT32(21000 - PHASE::LEAD_US, PHASE::startAt(16000, true, next));
+  TEST_ASSERT_EQUAL_UINT32(20800, PHASE::startAt(20800, true, next)); // đã sát: bắt đầu ngay
+}
+
+void test_prediction_across_wrap() {
+  uint32_t next = 0;
+  TEST_ASSERT_TRUE(PHASE::predictNext(0xFFFFFF00u, 0x00000100u, 1000, next));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFF00u + 1000, next);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_4000);
+  RUN_TEST(test_steady_7000);
+  RUN_TEST(test_steady_11000);
+  RUN_TEST(test_accel_4000);
+  RUN_TEST(test_accel_7000);
+  RUN_TEST(test_no_prediction_when_edges_stop);
+  RUN_TEST(test_prediction_across_wrap);
+  return UNITY_END();
+}
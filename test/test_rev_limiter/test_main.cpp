@@ -0,0 +1,149 @@
+// Rev limiter (LIMIT::) trên timer mô phỏng: vùng SOFT/HARD theo từng cạnh, trễ khi rời vùng,
+// mẫu cắt N/M, launch và động cơ mô phỏng (+40 rpm mỗi lần nổ, -60 mỗi lần bị cắt).
+#include <unity.h>
+#include <string>
+#include <stdio.h>
+#include "rev_limiter.h"
+#include "cut_timer.h"
+
+static constexpr uint8_t PIN = 6;
+static constexpr uint32_t K = 60000000UL;   // ppr 1
+
+static uint32_t s_t;
+
+static LIMIT::Params params() {
+  LIMIT::Params p{};
+  p.enable = true;
+  p.hard_rpm = 12000; p.soft_rpm = 11700; p.hyst_rpm = 100;
+  p.soft_cut = 1; p.soft_of = 3;
+  p.hard_cut = 1; p.hard_of = 1;
+  p.launch_enable = false; p.launch_rpm = 6000;
+  p.line = CutLine::IGN;
+  p.rpm_on_line = false;
+  return p;
+}
+
+// 1 cạnh ở rpm cho trước (cạnh trước cách đúng 1 chu kỳ)
+static void edge(uint32_t rpm) { s_t += K / rpm; CUTTMR::simAdvance(s_t); LIMIT::onEdge(s_t); }
+
+// n lần đánh lửa ở rpm không đổi, trả về 'X'/'.' = chân IGN đang cắt tại từng lần
+static std::string run(uint32_t rpm, int n) {
+  std::string s;
+  for (int k = 0; k < n; k++) {
+    s_t += K / rpm;
+    CUTTMR::simAdvance(s_t);
+    s += CUTTMR::simPin(PIN) ? 'X' : '.';
+    LIMIT::onEdge(s_t);
+  }
+  return s;
+}
+
+// bỏ qua gap µs (nhả các yêu cầu còn treo) rồi đặt cạnh mốc mới sau configure()
+static void reanchor(uint32_t gap) { s_t += gap; CUTTMR::simAdvance(s_t); LIMIT::onEdge(s_t); }
+
+void setUp() {
+  CUT::begin(PIN, 7);
+  s_t = 1000; CUTTMR::simAdvance(s_t);
+  LIMIT::armLaunch(false);
+  LIMIT::configure(params(), K);
+  LIMIT::resetStats();
+  LIMIT::onEdge(s_t);                          // cạnh mốc
+}
+void tearDown() {}
+
+void test_below_soft_never_cuts() {
+  TEST_ASSERT_EQUAL_STRING("..........", run(11500, 10).c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, LIMIT::stats().cuts);
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::NONE, (uint8_t)LIMIT::stats().zone);
+}
+
+void test_soft_and_hard_patterns() {
+  // cạnh k quyết định lần đánh lửa k+1
+  TEST_ASSERT_EQUAL_STRING(".X..X..X..", run(11800, 10).c_str());   // soft 1/3
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::SOFT, (uint8_t)LIMIT::stats().zone);
+  TEST_ASSERT_EQUAL_STRING("XXXXXXXXXX", run(12100, 10).c_str());   // hard 1/1 (lần đầu: mẫu soft)
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::HARD, (uint8_t)LIMIT::stats().zone);
+
+  LIMIT::Params p = params();
+  p.hard_cut = 2; p.hard_of = 3;
+  LIMIT::configure(p, K);
+  reanchor(2 * K / 12100);                      // nhả yêu cầu cũ
+  TEST_ASSERT_EQUAL_STRING(".XX.XX.XX.", run(12100, 10).c_str());   // hard 2/3
+}
+
+void test_zone_hysteresis() {
+  edge(11800);
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::SOFT, (uint8_t)LIMIT::stats().zone);
+  edge(11650);                                  // dưới soft nhưng chưa qua soft - hyst
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::SOFT, (uint8_t)LIMIT::stats().zone);
+  edge(11590);
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::NONE, (uint8_t)LIMIT::stats().zone);
+  edge(11650);                                  // vào lại phải vượt soft
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::NONE, (uint8_t)LIMIT::stats().zone);
+
+  edge(12050);
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::HARD, (uint8_t)LIMIT::stats().zone);
+  edge(11950);                                  // trong trễ của hard
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::HARD, (uint8_t)LIMIT::stats().zone);
+  edge(11880);                                  // rời hard, vẫn trên soft
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::SOFT, (uint8_t)LIMIT::stats().zone);
+  edge(11500);
+  TEST_ASSERT_EQUAL((uint8_t)LIMIT::Zone::NONE, (uint8_t)LIMIT::stats().zone);
+}
+
+void test_launch_threshold_only_when_armed() {
+  LIMIT::Params p = params();
+  p.enable = false; p.launch_enable = true;
+  LIMIT::configure(p, K);
+  reanchor(0);
+  TEST_ASSERT_EQUAL_STRING("..........", run(6500, 10).c_str());
+  LIMIT::armLaunch(true);
+  TEST_ASSERT_TRUE(LIMIT::stats().launch);
+  TEST_ASSERT_EQUAL_STRING(".XXXXX", run(6100, 6).c_str());
+  LIMIT::armLaunch(false);
+  reanchor(2 * K / 6100);
+  TEST_ASSERT_EQUAL_STRING("......", run(6500, 6).c_str());
+}
+
+void test_engine_held_at_limit() {
+  // động cơ mô phỏng: mỗi lần nổ +40 rpm, mỗi lần bị cắt -60 rpm
+  double rpm = 11000; uint32_t peak = 0; double sum = 0; int n = 0;
+  for (int k = 0; k < 600; k++) {
+    s_t += (uint32_t)(K / rpm);
+    CUTTMR::simAdvance(s_t);
+    rpm += CUTTMR::simPin(PIN) ? -60 : 40;
+    LIMIT::onEdge(s_t);
+    if (rpm > peak) peak = (uint32_t)rpm;
+    if (k >= 300) { sum += rpm; n++; }
+  }
+  printf("  đỉnh %u rpm, trung bình %.0f rpm, %u lần cắt\n", (unsigned)peak, sum / n, (unsigned)LIMIT::stats().cuts);
+  TEST_ASSERT_LESS_OR_EQUAL(12000 + 40, peak);
+  TEST_ASSERT_GREATER_OR_EQUAL(11600, (uint32_t)(sum / n));
+  TEST_ASSERT_GREATER_THAN(0, LIMIT::stats().cuts);
+  TEST_ASSERT_UINT32_WITHIN(40, 12000, LIMIT::stats().peak_rpm);
+}
+
+void test_rpm_from_cut_line_is_rejected() {
+  LIMIT::Params p = params();
+  p.rpm_on_line = true;
+  TEST_ASSERT_FALSE(LIMIT::configure(p, K));
+  TEST_ASSERT_TRUE(LIMIT::stats().blocked);
+  reanchor(0);
+  TEST_ASSERT_EQUAL_STRING("......", run(13000, 6).c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, LIMIT::stats().cuts);
+
+  p.line = CutLine::INJ; p.rpm_on_line = false;  // cắt INJ: coil vẫn nổ, cạnh không mất
+  TEST_ASSERT_TRUE(LIMIT::configure(p, K));
+  TEST_ASSERT_FALSE(LIMIT::stats().blocked);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_below_soft_never_cuts);
+  RUN_TEST(test_soft_and_hard_patterns);
+  RUN_TEST(test_zone_hysteresis);
+  RUN_TEST(test_launch_threshold_only_when_armed);
+  RUN_TEST(test_engine_held_at_limit);
+  RUN_TEST(test_rpm_from_cut_line_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,80 @@
+// RPM::get() = 1 phép chia nguyên với hằng số gộp PPR & scale (RPM::configure):
+// sai số tối đa so với công thức float cũ trên toàn dải 0–20000 rpm, và ns/lần gọi.
+#include <unity.h>
+#include <chrono>
+#include <stdlib.h>
+#include "rpm_rmt.h"
+#include "rpm_capture.h"
+
+static uint32_t s_edges[3];
+
+// Công bố đúng 1 chu kỳ p qua tick() rồi đọc get()
+static uint16_t rpmAt(uint32_t p) {
+  RPM::begin(2);
+  s_edges[0] = 1000; s_edges[1] = 1000 + p; s_edges[2] = 1000 + 2 * p;
+  CAP::replayLoad(s_edges, 3);
+  CAP::replayAdvance(s_edges[2]);
+  RPM::tick();
+  return RPM::get();
+}
+
+// Bản cũ: 60e6 / (p * ppr) * scale rồi kẹp 0..20000
+static uint16_t floatRef(uint32_t p, float ppr, float scale) {
+  float r = 60.0f * 1e6f / ((float)p * ppr);
+  r *= scale;
+  if (r > 20000) r = 20000;
+  return (uint16_t)r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_max_error_vs_float_reference() {
+  const float pprs[]   = {0.5f, 1.0f, 2.0f};
+  const float scales[] = {0.97f, 1.0f, 1.03f};
+  for (float ppr : pprs) for (float sc : scales) {
+    int maxerr = 0;
+    for (uint32_t p = 60; p < 1000000; p += (p < 5000 ? 1 : p / 500)) {
+      RPM::configure(ppr, sc);
+      const int err = abs((int)rpmAt(p) - (int)floatRef(p, ppr, sc));
+      if (err > maxerr) maxerr = err;
+    }
+    char m[64]; snprintf(m, sizeof(m), "ppr=%.1f scale=%.2f maxerr=%d rpm", ppr, sc, maxerr);
+    TEST_MESSAGE(m);
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(1, maxerr, m); // chỉ khác nhau ở làm tròn float
+  }
+}
+
+void test_get_cost() {
+  RPM::configure(1.0f, 1.0f);
+  rpmAt(5000);
+  const int N = 2000000;
+  volatile uint32_t acc = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) acc += RPM::get();
+  const double ns_int = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  volatile uint32_t p = 5000; volatile float ppr = 1.0f, sc = 1.0f;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) acc += floatRef(p, ppr, sc);
+  const double ns_flt = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  TEST_ASSERT_EQUAL(12000, RPM::get());
+  char m[80]; snprintf(m, sizeof(m), "get(): %.1f ns/call, float ref: %.1f ns/call", ns_int, ns_flt);
+  TEST_MESSAGE(m);
+}
+
+void test_configure_only_changes_constant() {
+  RPM::configure(2.0f, 1.0f);
+  TEST_ASSERT_EQUAL(30000000u, RPM::rpmConst());
+  RPM::configure(0.01f, 1.0f); // kẹp ppr >= 0.1
+  TEST_ASSERT_UINT32_WITHIN(60, 600000000u, RPM::rpmConst()); // 0.1f không biểu diễn chính xác
+  RPM::configure(1.0f, 0.0f);  // scale <= 0 → 1
+  TEST_ASSERT_EQUAL(60000000u, RPM::rpmConst());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_max_error_vs_float_reference);
+  RUN_TEST(test_get_cost);
+  RUN_TEST(test_configure_only_changes_constant);
+  return UNITY_END();
+}
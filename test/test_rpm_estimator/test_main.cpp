@@ -0,0 +1,99 @@
+// Bộ ước lượng alpha-beta của RPM:: (filtered/accel/predict) với ramp tăng/giảm tốc tổng hợp:
+// số cạnh tới khi accel hội tụ, sai số khi giữ ga, sai số dự báo 20 ms.
+#include <unity.h>
+#include <vector>
+#include <stdlib.h>
+#include <math.h>
+#include "rpm_rmt.h"
+#include "rpm_capture.h"
+
+// 3000 rpm 0.3 s → +20000 rpm/s tới 9000 → giữ 0.3 s → −30000 rpm/s tới 4000 → giữ
+static double rpmAt(double t) {
+  if (t < 0.3)    return 3000;
+  if (t < 0.6)    return 3000 + 20000 * (t - 0.3);
+  if (t < 0.9)    return 9000;
+  if (t < 1.0667) return 9000 - 30000 * (t - 0.9);
+  return 4000;
+}
+
+static const uint32_t T0 = 1000;
+static std::vector<uint32_t> s_edges;
+
+static void buildEngine(uint32_t jitter_us) {
+  s_edges.clear(); s_edges.push_back(T0);
+  srand(1);
+  double ph = 0, t = 0;
+  while (t < 1.5) {
+    ph += rpmAt(t) / 60 * 1e-6; t += 1e-6;
+    if (ph >= 1) { ph -= 1; s_edges.push_back(T0 + (uint32_t)(t * 1e6) + (jitter_us ? rand() % jitter_us : 0)); }
+  }
+}
+
+struct Result { int conv_up, conv_down; double hold_err, pred_err, naive_err; };
+
+static Result run() {
+  RPM::begin(2); RPM::configure(1, 1);
+  CAP::replayLoad(s_edges.data(), s_edges.size());
+  Result r = {-1, -1, 0, 0, 0};
+  int n_up = 0, n_down = 0;
+  for (size_t i = 1; i < s_edges.size(); i++) {
+    CAP::replayAdvance(s_edges[i]); RPM::tick();
+    const double t = (s_edges[i] - T0) / 1e6;
+    const int a = RPM::accel();
+    if (t > 0.3 && t < 0.6)  { n_up++;   if (r.conv_up < 0 && abs(a - 20000) < 2000) r.conv_up = n_up; }
+    if (t > 0.9 && t < 1.06) { n_down++; if (r.conv_down < 0 && abs(a + 30000) < 3000) r.conv_down = n_down; }
+    if (t > 0.75 && t < 0.9) r.hold_err = fmax(r.hold_err, fabs(RPM::filtered() - 9000.0));
+    if (t > 0.45 && t < 0.55) { // giữa ramp, accel đã hội tụ
+      r.pred_err  = fmax(r.pred_err,  fabs(RPM::predict(20)  - rpmAt(t + 0.02)));
+      r.naive_err = fmax(r.naive_err, fabs(RPM::filtered()   - rpmAt(t + 0.02)));
+    }
+  }
+  return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_ramp_convergence_clean() {
+  buildEngine(0);
+  const Result r = run();
+  char m[160]; snprintf(m, sizeof(m), "accel hội tụ: tăng %d cạnh, giảm %d cạnh; giữ ga sai %.0f rpm; "
+                        "rpm sau 20ms: predict() sai %.0f, filtered() sai %.0f",
+                        r.conv_up, r.conv_down, r.hold_err, r.pred_err, r.naive_err);
+  TEST_MESSAGE(m);
+  TEST_ASSERT_TRUE(r.conv_up > 0 && r.conv_up <= 15);
+  TEST_ASSERT_TRUE(r.conv_down > 0 && r.conv_down <= 20);
+  TEST_ASSERT_LESS_OR_EQUAL(10, r.hold_err);
+  // chu kỳ đo = rpm trung bình nửa chu kỳ trước → còn trễ cố hữu, nhưng phải tốt hơn hẳn không dự báo
+  TEST_ASSERT_LESS_OR_EQUAL(r.naive_err / 2, r.pred_err);
+}
+
+void test_ramp_convergence_jitter() {
+  buildEngine(20); // 0..20 µs jitter timestamp
+  const Result r = run();
+  char m[96]; snprintf(m, sizeof(m), "jitter 20us: tăng %d cạnh, giảm %d cạnh; giữ ga sai %.0f rpm",
+                       r.conv_up, r.conv_down, r.hold_err);
+  TEST_MESSAGE(m);
+  TEST_ASSERT_TRUE(r.conv_up > 0 && r.conv_up <= 20);
+  TEST_ASSERT_TRUE(r.conv_down > 0 && r.conv_down <= 25);
+  TEST_ASSERT_LESS_OR_EQUAL(30, r.hold_err);
+}
+
+void test_steady_accel_zero() {
+  s_edges.clear();
+  for (int i = 0; i < 200; i++) s_edges.push_back(T0 + i * 10000); // 6000 rpm
+  RPM::begin(2); RPM::configure(1, 1);
+  CAP::replayLoad(s_edges.data(), s_edges.size());
+  CAP::replayAdvance(s_edges.back()); RPM::tick();
+  TEST_ASSERT_EQUAL(6000, RPM::filtered());
+  TEST_ASSERT_INT_WITHIN(50, 0, RPM::accel());
+  TEST_ASSERT_INT_WITHIN(2, 6000, RPM::predict(50));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_convergence_clean);
+  RUN_TEST(test_ramp_convergence_jitter);
+  RUN_TEST(test_steady_accel_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+// Lọc nhiễu coil của RPM:: (blanking trong backend capture + loại outlier theo trung vị)
+// trên chuỗi xung nhiễu tổng hợp theo kiểu đo được trên coil 1 xi-lanh: ringing sát cạnh,
+// gai muộn, mất xung, tăng/giảm tốc và nhảy rpm.
+#include <unity.h>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include "rpm_rmt.h"
+#include "rpm_capture.h"
+
+struct Truth { uint32_t t; double rpm; };
+static std::vector<uint32_t> s_edges;
+static std::vector<Truth> s_truth;
+
+static double profile(double rpm0, double rpm1, bool jump, int i, int n) {
+  return jump ? (i < n / 2 ? rpm0 : rpm1) : rpm0 + (rpm1 - rpm0) * i / n;
+}
+
+static void buildTrace(double rpm0, double rpm1, bool noise, bool jump, int n = 600) {
+  s_edges.clear(); s_truth.clear();
+  srand(7);
+  uint32_t t = 1000;
+  for (int i = 0; i < n; i++) {
+    const double rpm = profile(rpm0, rpm1, jump, i, n);
+    const uint32_t p = (uint32_t)(60e6 / rpm);
+    s_truth.push_back({t, rpm});
+    s_edges.push_back(t);
+    if (noise) {
+      const int r = rand() % 100;
+      if (r < 30)      s_edges.push_back(t + p * (5 + rand() % 25) / 100);  // ringing
+      else if (r < 33) s_edges.push_back(t + p * (55 + rand() % 30) / 100); // gai muộn
+      else if (r < 35) s_edges.pop_back();                                  // mất xung
+    }
+    t += p;
+  }
+  std::sort(s_edges.begin(), s_edges.end());
+}
+
+// Số mẫu get() lệch > lim so với rpm thật (bỏ 10 cạnh đầu)
+static int replayCountBad(double lim, double* maxdev = nullptr) {
+  RPM::begin(2); RPM::configure(1, 1);
+  CAP::replayLoad(s_edges.data(), s_edges.size());
+  size_t idx = 0; int bad = 0; double md = 0;
+  for (size_t k = 1; k < s_edges.size(); k++) {
+    CAP::replayAdvance(s_edges[k] + 1); RPM::tick();
+    while (idx + 1 < s_truth.size() && s_truth[idx + 1].t <= s_edges[k]) idx++;
+    if (k <= 10) continue;
+    const double d = (RPM::get() - s_truth[idx].rpm) / s_truth[idx].rpm;
+    if (d > lim || d < -lim) bad++;
+    md = std::max(md, d < 0 ? -d : d);
+  }
+  if (maxdev) *maxdev = md;
+  return bad;
+}
+
+// max_gross: số mẫu lệch > 30% (rpm nhảy đôi/giảm nửa) cho phép — chỉ để xác nhận nhảy rpm thật.
+// Gai muộn ở 0.8–0.85 chu kỳ không phân biệt được với tăng tốc thật → vẫn cho lệch ≤ 25%,
+// giới hạn ở max_pct % số mẫu.
+static void check(double rpm0, double rpm1, bool noise, bool jump, int max_gross, int max_pct) {
+  buildTrace(rpm0, rpm1, noise, jump);
+  double md;
+  const int gross = replayCountBad(0.30, &md);
+  const int bad   = replayCountBad(0.15);
+  const RPM::Stats st = RPM::stats();
+  char m[192];
+  snprintf(m, sizeof(m), "%g->%g noise=%d jump=%d: edges=%zu >30%%: %d >15%%: %d maxdev=%.0f%% acc=%u blank=%u outl=%u",
+           rpm0, rpm1, noise, jump, s_edges.size(), gross, bad, md * 100, st.accepted, st.blanked, st.outliers);
+  TEST_MESSAGE(m);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(max_gross, gross, m);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE((int)s_truth.size() * max_pct / 100, bad, m);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_noisy_accel()       { check(3000, 12000, true, false, 0, 4); }
+void test_noisy_decel()       { check(12000, 3000, true, false, 0, 4); }
+void test_noisy_steady()      { check(8000, 8000, true, false, 0, 4); }
+// Nhảy rpm tức thời (máy phát PWM test): vài cạnh mới bị blanking/chờ xác nhận trước khi bắt kịp
+void test_clean_jump_up()     { check(1000, 5000, false, true, 6, 1); }
+void test_clean_jump_down()   { check(5000, 1000, false, true, 3, 1); }
+void test_noisy_jump()        { check(2000, 9000, true, true, 8, 4); }
+
+// Gai lọt blanking ở ~0.7 chu kỳ khiến cạnh thật kế tiếp bị blanking; máy đang tăng tốc nên
+// khoảng tới cạnh sau đó chỉ ~1.7× trung vị — không được nhận thành chu kỳ (đọc thấp ~41%).
+void test_spike_hides_real_edge_while_accelerating() {
+  s_edges.clear();
+  uint32_t t = 1000;
+  for (int i = 0; i < 20; i++) { s_edges.push_back(t); t += 10000; } // 6000 rpm
+  const uint32_t e = s_edges.back();
+  s_edges.push_back(e + 7000);          // gai: 0.7 chu kỳ > 40% blanking
+  s_edges.push_back(e + 8500);          // cạnh thật (chu kỳ 0.85) → bị blanking sau gai
+  for (int i = 2; i < 6; i++) s_edges.push_back(e + 8500 * i);
+  RPM::begin(2); RPM::configure(1, 1);
+  CAP::replayLoad(s_edges.data(), s_edges.size());
+  uint16_t lo = 0xFFFF;
+  for (size_t k = 1; k < s_edges.size(); k++) {
+    CAP::replayAdvance(s_edges[k] + 1); RPM::tick();
+    if (k > 10) lo = std::min(lo, RPM::get());
+  }
+  TEST_ASSERT_TRUE(RPM::stats().blanked >= 1);
+  TEST_ASSERT_GREATER_OR_EQUAL(5900, lo);
+  TEST_ASSERT_INT_WITHIN(10, 7059, RPM::get());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_noisy_accel);
+  RUN_TEST(test_noisy_decel);
+  RUN_TEST(test_noisy_steady);
+  RUN_TEST(test_clean_jump_up);
+  RUN_TEST(test_clean_jump_down);
+  RUN_TEST(test_noisy_jump);
+  RUN_TEST(test_spike_hides_real_edge_while_accelerating);
+  return UNITY_END();
+}
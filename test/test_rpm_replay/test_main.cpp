@@ -0,0 +1,88 @@
+// Hồi quy RPM:: qua backend replay (rpm_capture_replay.cpp): độ chính xác và chi phí tick()
+// ở 1k–20k rpm, xung đều và xung có jitter timestamp.
+#include <unity.h>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include "rpm_rmt.h"
+#include "rpm_capture.h"
+
+static std::vector<uint32_t> s_edges;
+
+static void makeTrain(uint32_t rpm, size_t n, uint32_t jitter_us, uint32_t seed) {
+  s_edges.clear();
+  srand(seed);
+  const double p = 60e6 / rpm;
+  for (size_t i = 0; i < n; i++) {
+    const int32_t j = jitter_us ? (int32_t)(rand() % (2 * jitter_us + 1)) - (int32_t)jitter_us : 0;
+    s_edges.push_back(1000 + (uint32_t)(i * p + 0.5) + j);
+  }
+}
+
+// Phát lại từng cạnh như loop gọi tick() ngay sau khi có cạnh; trả về ns/tick trung bình
+static double replay(size_t batch) {
+  CAP::replayLoad(s_edges.data(), s_edges.size());
+  double ns = 0; size_t calls = 0;
+  for (size_t i = 0; i < s_edges.size(); i += batch) {
+    const size_t last = std::min(i + batch, s_edges.size()) - 1;
+    CAP::replayAdvance(s_edges[last] + 10);
+    const auto t0 = std::chrono::steady_clock::now();
+    RPM::tick();
+    ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    calls++;
+  }
+  return ns / calls;
+}
+
+void setUp() { RPM::begin(2); RPM::configure(1.0f, 1.0f); }
+void tearDown() {}
+
+void test_clean_train_1k_to_20k() {
+  for (uint32_t rpm = 1000; rpm <= 20000; rpm += 1000) {
+    RPM::begin(2);
+    makeTrain(rpm, 200, 0, 1);
+    replay(1);
+    char m[32]; snprintf(m, sizeof(m), "rpm %u", (unsigned)rpm);
+    TEST_ASSERT_INT_WITHIN_MESSAGE(1 + rpm / 2000, rpm, RPM::get(), m); // làm tròn chu kỳ µs
+    TEST_ASSERT_EQUAL_MESSAGE(0, CAP::overruns(), m);
+  }
+}
+
+void test_jitter_train_within_half_percent() {
+  for (uint32_t rpm = 1000; rpm <= 20000; rpm += 1000) {
+    RPM::begin(2);
+    makeTrain(rpm, 400, 5, rpm);               // ±5 µs jitter timestamp
+    replay(1);
+    char m[32]; snprintf(m, sizeof(m), "rpm %u", (unsigned)rpm);
+    const uint32_t p = 60000000u / rpm;
+    TEST_ASSERT_INT_WITHIN_MESSAGE((uint32_t)((uint64_t)rpm * 10 / p) + 1, rpm, RPM::get(), m); // ±10 µs/chu kỳ
+    TEST_ASSERT_INT_WITHIN_MESSAGE(rpm / 200 + 1, rpm, RPM::filtered(), m);
+  }
+}
+
+void test_batched_drain_same_result() {
+  // loop chậm: 12 cạnh / lần tick() (ring 64 không tràn)
+  makeTrain(12000, 600, 0, 1);
+  const double ns = replay(12);
+  TEST_ASSERT_INT_WITHIN(7, 12000, RPM::get());
+  TEST_ASSERT_EQUAL(0, CAP::overruns());
+  char m[64]; snprintf(m, sizeof(m), "tick() 12 cạnh: %.0f ns", ns);
+  TEST_MESSAGE(m);
+}
+
+void test_timeout_reads_zero() {
+  makeTrain(3000, 50, 0, 1);
+  replay(1);
+  TEST_ASSERT_TRUE(RPM::get() > 0);
+  CAP::replayAdvance(s_edges.back() + 600000);
+  TEST_ASSERT_EQUAL(0, RPM::get());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_train_1k_to_20k);
+  RUN_TEST(test_jitter_train_within_half_percent);
+  RUN_TEST(test_batched_drain_same_result);
+  RUN_TEST(test_timeout_reads_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,100 @@
+// Skip-fire (SKIP::) trên timer mô phỏng: trạng thái chân cắt tại từng lần đánh lửa phải
+// đúng mẫu (bit i của mask ↔ lần i), hết mẫu thì cắt liền tới hết cửa sổ.
+#include <unity.h>
+#include <string>
+#include <chrono>
+#include <stdio.h>
+#include "skip_fire.h"
+#include "cut_timer.h"
+
+static constexpr uint8_t PIN = 6;
+static constexpr uint32_t PER = 60000000 / 12500;  // 12500 rpm, 1 lần đánh lửa/vòng
+static constexpr uint32_t LEAD = 300, WINDOW = 60000;
+
+// Chạy phiên, trả về chuỗi 'X'/'.' = chân IGN đang cắt tại lần đánh lửa 0..n-1.
+// drop: lần đánh lửa bị mất cạnh (không gọi onEdge), -1 = không mất.
+static std::string run(uint32_t mask, uint8_t len, uint32_t per, int n, int drop = -1) {
+  CUT::begin(PIN, 7);
+  const uint32_t next = 100000;
+  CUTTMR::simAdvance(next - per / 2);
+  SKIP::start(CutLine::IGN, mask, len, next - LEAD, WINDOW, per, next);
+  std::string s;
+  for (int k = 0; k < n; k++) {
+    const uint32_t t = next + k * PER;
+    CUTTMR::simAdvance(t);
+    s += CUTTMR::simPin(PIN) ? 'X' : '.';
+    if (k != drop) SKIP::onEdge(t);
+  }
+  CUTTMR::simAdvance(next + n * PER + WINDOW);
+  return s;
+}
+
+static std::string expected(uint32_t mask, uint8_t len, int n) {
+  std::string s;
+  for (int k = 0; k < n; k++) {
+    const bool in = k * PER + LEAD < WINDOW;
+    s += (in && (k >= len || ((mask >> k) & 1u))) ? 'X' : '.';
+  }
+  return s;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_patterns_follow_mask() {
+  for (uint8_t p = 1; p < SKIP::COUNT; p++) {
+    const SKIP::Pattern& pt = SKIP::PATTERNS[p];
+    const std::string got = run(pt.mask, pt.len, PER, 16);
+    printf("  %-14s %s\n", pt.name, got.c_str());
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected(pt.mask, pt.len, 16).c_str(), got.c_str(), pt.name);
+    TEST_ASSERT_FALSE(CUT::isActive());
+    TEST_ASSERT_FALSE(SKIP::active());
+  }
+}
+
+void test_no_period_cuts_solid() {
+  TEST_ASSERT_EQUAL_STRING("XXXXXXXXXXXXX...", run(0x0D, 5, 0, 16).c_str());
+}
+
+void test_missed_edge_releases_by_itself() {
+  // mất cạnh lần 0 (mask 1/2): yêu cầu đầu tự nhả trước lần 1, không cắt liền; mẫu đếm
+  // theo cạnh nhận được nên đi tiếp từ cạnh lần 1 (lệch 1 lần đánh lửa)
+  const std::string s = run(0x55555555u, 32, PER, 6, 0);
+  TEST_ASSERT_EQUAL_STRING("X..X.X", s.c_str());
+}
+
+void test_stop_ends_session() {
+  CUT::begin(PIN, 7);
+  CUTTMR::simAdvance(1000);
+  SKIP::start(CutLine::IGN, 0x55555555u, 32, 1000, WINDOW, PER, 1000 + PER);
+  TEST_ASSERT_TRUE(SKIP::active());
+  SKIP::stop();
+  TEST_ASSERT_FALSE(SKIP::active());
+  SKIP::onEdge(1000 + PER);
+  CUTTMR::simAdvance(1000 + 3 * PER);
+  TEST_ASSERT_FALSE(CUT::isActive());
+}
+
+void test_on_edge_cost() {
+  CUT::begin(PIN, 7);
+  uint32_t t = 0; CUTTMR::simAdvance(t);
+  const auto t0 = std::chrono::steady_clock::now();
+  long n = 0;
+  for (int r = 0; r < 20000; r++) {
+    SKIP::start(CutLine::IGN, 0x0D, 5, t, 1000000, PER, t + PER);
+    for (int k = 0; k < 20; k++) { t += PER; CUTTMR::simAdvance(t); SKIP::onEdge(t); n++; }
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+  printf("  onEdge + scheduler: %.0f ns/cạnh (host)\n", ns);
+  TEST_ASSERT_TRUE(ns < 5000);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_patterns_follow_mask);
+  RUN_TEST(test_no_period_cuts_solid);
+  RUN_TEST(test_missed_edge_releases_by_itself);
+  RUN_TEST(test_stop_ends_session);
+  RUN_TEST(test_on_edge_cost);
+  return UNITY_END();
+}
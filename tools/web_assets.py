@@ -0,0 +1,87 @@
+# tools/web_assets.py
+# PlatformIO extra_script (pre): đóng gói web UI cho LittleFS.
+#   data/        : nguồn (sửa ở đây)
+#   data_build/  : ảnh LittleFS thật (platformio.ini: data_dir), sinh lại mỗi lần build, không commit
+# - Mọi file được gzip -9 (mtime = 0 → cùng nội dung thì cùng byte).
+# - File không phải .html được đổi tên theo hash nội dung: app.js → app.<hash8>.js,
+#   tham chiếu trong .html được sửa theo → phục vụ với Cache-Control immutable.
+# - .html giữ URL cố định nên dùng ETag + no-cache (trình duyệt hỏi lại, 304 nếu không đổi).
+# - /assets.map: mỗi dòng "url<TAB>path<TAB>mime<TAB>etag<TAB>cache-control", web_ui.cpp đọc
+#   lúc mở portal; path là tên logic, file thật trên FS là path + ".gz".
+# Chạy tay được: python tools/web_assets.py
+import gzip
+import hashlib
+import os
+import shutil
+
+MIME = {
+    ".html": "text/html", ".js": "application/javascript", ".css": "text/css",
+    ".json": "application/json", ".svg": "image/svg+xml", ".png": "image/png",
+    ".ico": "image/x-icon", ".txt": "text/plain",
+}
+CACHE_IMMUTABLE = "public, max-age=31536000, immutable"
+CACHE_REVALIDATE = "no-cache"
+
+
+def h8(data):
+    return hashlib.sha256(data).hexdigest()[:8]
+
+
+def build(project_dir):
+    src = os.path.join(project_dir, "data")
+    out = os.path.join(project_dir, "data_build")
+    shutil.rmtree(out, ignore_errors=True)
+    os.makedirs(out)
+
+    files = {}
+    for root, _, names in os.walk(src):
+        for n in sorted(names):
+            p = os.path.join(root, n)
+            rel = "/" + os.path.relpath(p, src).replace(os.sep, "/")
+            with open(p, "rb") as f:
+                files[rel] = f.read()
+
+    # Asset (không phải html): tên mới theo hash
+    rename = {}
+    for rel, data in files.items():
+        if not rel.endswith(".html"):
+            stem, ext = os.path.splitext(rel)
+            rename[rel] = "%s.%s%s" % (stem, h8(data), ext)
+
+    entries = []
+    raw_total = gz_total = 0
+    for rel, data in sorted(files.items()):
+        if rel.endswith(".html"):
+            for old, new in rename.items():
+                data = data.replace(('"%s"' % old).encode(), ('"%s"' % new).encode())
+                data = data.replace(('"%s"' % old[1:]).encode(), ('"%s"' % new).encode())
+            path, cache = rel, CACHE_REVALIDATE
+        else:
+            path, cache = rename[rel], CACHE_IMMUTABLE
+        gz = gzip.compress(data, compresslevel=9, mtime=0)
+        dst = os.path.join(out, path[1:] + ".gz")
+        os.makedirs(os.path.dirname(dst), exist_ok=True)
+        with open(dst, "wb") as f:
+            f.write(gz)
+        mime = MIME.get(os.path.splitext(rel)[1], "application/octet-stream")
+        etag = '"%s"' % h8(gz)
+        entries.append((path, path, mime, etag, cache))
+        if rel == "/index.html":
+            entries.append(("/", path, mime, etag, cache))
+        raw_total += len(data)
+        gz_total += len(gz)
+        print("[web_assets] %-28s %6d -> %6d B" % (path, len(data), len(gz)))
+
+    with open(os.path.join(out, "assets.map"), "w", newline="\n") as f:
+        for e in entries:
+            f.write("\t".join(e) + "\n")
+    if raw_total:
+        print("[web_assets] total %d -> %d B (%.1fx)" % (raw_total, gz_total, raw_total / float(gz_total)))
+
+
+try:
+    Import("env")  # noqa: F821 — chỉ có khi chạy trong SCons/PlatformIO
+    build(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        build(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))